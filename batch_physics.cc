@@ -0,0 +1,188 @@
+#include "batch_physics.hh"
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_PHYSICS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace pro2 {
+
+// Un paso de la entidad k (mismas reglas que EnemyPool::step)
+static inline void step_one(PhysicsBatch b, PhysicsFloors f, int k) {
+    b.vy[k] += 1;  // Gravedad
+    const int ox = b.x[k], oy = b.y[k];
+    int       nx = ox + b.vx[k], ny = oy + b.vy[k];
+    bool      grounded = false;
+    for (int j = 0; j < f.rounds; j++) {
+        const int l = f.left[j * f.stride + k], r = f.right[j * f.stride + k], t = f.top[j * f.stride + k];
+        if (l <= ox && ox <= r && l <= nx && nx <= r && oy <= t && ny >= t) {
+            ny = t;
+            b.vy[k] = 0;
+            grounded = true;
+        }
+    }
+    if (!grounded && oy <= ny) {
+        b.vx[k] = -b.vx[k];
+    }
+    if (ny > oy + 20) {
+        b.vx[k] = -b.vx[k];
+        nx = ox;
+    }
+    b.x[k] = nx;
+    b.y[k] = ny;
+}
+
+void physics_step_scalar(PhysicsBatch batch, PhysicsFloors floors) {
+    for (int k = 0; k < batch.n; k++) {
+        step_one(batch, floors, k);
+    }
+}
+
+#ifdef BATCH_PHYSICS_X86
+
+// 4 entidades por iteración, sin saltos: cada condición es una máscara y
+// las asignaciones condicionales se hacen con and/andnot/or
+__attribute__((target("sse2"))) static void physics_step_sse2(PhysicsBatch b, PhysicsFloors f) {
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i twenty = _mm_set1_epi32(20);
+    const __m128i zero = _mm_setzero_si128();
+    int           k = 0;
+    for (; k + 4 <= b.n; k += 4) {
+        const __m128i ox = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.x + k));
+        const __m128i oy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.y + k));
+        __m128i       vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.vx + k));
+        __m128i       vy = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b.vy + k)), one);
+        __m128i       nx = _mm_add_epi32(ox, vx);
+        __m128i       ny = _mm_add_epi32(oy, vy);
+        __m128i       grounded = zero;
+        for (int j = 0; j < f.rounds; j++) {
+            const int     at = j * f.stride + k;
+            const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f.left + at));
+            const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f.right + at));
+            const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f.top + at));
+            // Falla si l > ox, ox > r, l > nx, nx > r, oy > t o t > ny
+            __m128i miss = _mm_or_si128(_mm_cmpgt_epi32(l, ox), _mm_cmpgt_epi32(ox, r));
+            miss = _mm_or_si128(miss, _mm_or_si128(_mm_cmpgt_epi32(l, nx), _mm_cmpgt_epi32(nx, r)));
+            miss = _mm_or_si128(miss, _mm_or_si128(_mm_cmpgt_epi32(oy, t), _mm_cmpgt_epi32(t, ny)));
+            ny = _mm_or_si128(_mm_and_si128(miss, ny), _mm_andnot_si128(miss, t));
+            vy = _mm_and_si128(miss, vy);
+            grounded = _mm_or_si128(grounded, _mm_andnot_si128(miss, _mm_cmpeq_epi32(zero, zero)));
+        }
+        // Media vuelta si no hay suelo y no sube (oy <= ny)
+        __m128i turn = _mm_andnot_si128(grounded, _mm_andnot_si128(_mm_cmpgt_epi32(oy, ny),
+                                                                    _mm_cmpeq_epi32(zero, zero)));
+        // Media vuelta y volver atrás si ha caído más de 20 píxels
+        const __m128i fell = _mm_cmpgt_epi32(ny, _mm_add_epi32(oy, twenty));
+        turn = _mm_xor_si128(turn, fell);
+        vx = _mm_or_si128(_mm_andnot_si128(turn, vx), _mm_and_si128(turn, _mm_sub_epi32(zero, vx)));
+        nx = _mm_or_si128(_mm_andnot_si128(fell, nx), _mm_and_si128(fell, ox));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b.x + k), nx);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b.y + k), ny);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b.vx + k), vx);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b.vy + k), vy);
+    }
+    for (; k < b.n; k++) {
+        step_one(b, f, k);
+    }
+}
+
+// 8 entidades por iteración, igual que la versión SSE2
+__attribute__((target("avx2"))) static void physics_step_avx2(PhysicsBatch b, PhysicsFloors f) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i twenty = _mm256_set1_epi32(20);
+    const __m256i zero = _mm256_setzero_si256();
+    int           k = 0;
+    for (; k + 8 <= b.n; k += 8) {
+        const __m256i ox = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.x + k));
+        const __m256i oy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.y + k));
+        __m256i       vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.vx + k));
+        __m256i       vy = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.vy + k)), one);
+        __m256i       nx = _mm256_add_epi32(ox, vx);
+        __m256i       ny = _mm256_add_epi32(oy, vy);
+        __m256i       grounded = zero;
+        for (int j = 0; j < f.rounds; j++) {
+            const int     at = j * f.stride + k;
+            const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f.left + at));
+            const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f.right + at));
+            const __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f.top + at));
+            __m256i miss = _mm256_or_si256(_mm256_cmpgt_epi32(l, ox), _mm256_cmpgt_epi32(ox, r));
+            miss = _mm256_or_si256(miss, _mm256_or_si256(_mm256_cmpgt_epi32(l, nx), _mm256_cmpgt_epi32(nx, r)));
+            miss = _mm256_or_si256(miss, _mm256_or_si256(_mm256_cmpgt_epi32(oy, t), _mm256_cmpgt_epi32(t, ny)));
+            ny = _mm256_blendv_epi8(t, ny, miss);
+            vy = _mm256_and_si256(miss, vy);
+            grounded = _mm256_or_si256(grounded, _mm256_andnot_si256(miss, _mm256_cmpeq_epi32(zero, zero)));
+        }
+        __m256i turn = _mm256_andnot_si256(grounded, _mm256_andnot_si256(_mm256_cmpgt_epi32(oy, ny),
+                                                                          _mm256_cmpeq_epi32(zero, zero)));
+        const __m256i fell = _mm256_cmpgt_epi32(ny, _mm256_add_epi32(oy, twenty));
+        turn = _mm256_xor_si256(turn, fell);
+        vx = _mm256_blendv_epi8(vx, _mm256_sub_epi32(zero, vx), turn);
+        nx = _mm256_blendv_epi8(nx, ox, fell);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b.x + k), nx);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b.y + k), ny);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b.vx + k), vx);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b.vy + k), vy);
+    }
+    for (; k < b.n; k++) {
+        step_one(b, f, k);
+    }
+}
+
+#endif
+
+typedef void (*PhysicsFn)(PhysicsBatch, PhysicsFloors);
+
+struct PhysicsImpl {
+    PhysicsFn   fn;
+    const char* name;
+};
+
+// Elegir la mejor versión disponible en este procesador (una sola vez)
+static PhysicsImpl choose_physics() {
+#ifdef BATCH_PHYSICS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {physics_step_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {physics_step_sse2, "sse2"};
+    }
+#endif
+    return {physics_step_scalar, "scalar"};
+}
+
+static const PhysicsImpl& physics_impl() {
+    static const PhysicsImpl impl = choose_physics();
+    return impl;
+}
+
+void physics_step(PhysicsBatch batch, PhysicsFloors floors) {
+    physics_impl().fn(batch, floors);
+}
+
+bool physics_step_with(const char* impl, PhysicsBatch batch, PhysicsFloors floors) {
+    const std::string name = impl;
+    if (name == "scalar") {
+        physics_step_scalar(batch, floors);
+        return true;
+    }
+#ifdef BATCH_PHYSICS_X86
+    __builtin_cpu_init();
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) {
+        physics_step_avx2(batch, floors);
+        return true;
+    }
+    if (name == "sse2" && __builtin_cpu_supports("sse2")) {
+        physics_step_sse2(batch, floors);
+        return true;
+    }
+#endif
+    return false;
+}
+
+const char* physics_step_impl() {
+    return physics_impl().name;
+}
+
+}  // namespace pro2
@@ -0,0 +1,74 @@
+#ifndef BATCH_PHYSICS_HH
+#define BATCH_PHYSICS_HH
+
+namespace pro2 {
+
+/**
+ * @brief Lote de `n` entidades guardadas por columnas (SoA).
+ */
+struct PhysicsBatch {
+    int* x;   ///< Posición (pies de la entidad)
+    int* y;
+    int* vx;  ///< Velocidad
+    int* vy;
+    int  n;
+};
+
+/**
+ * @brief Suelos candidatos de cada entidad de un lote, por rondas.
+ *
+ * La ronda j tiene un suelo para cada entidad: el de la entidad k está en
+ * `left[j * stride + k]`, `right[j * stride + k]` y `top[j * stride + k]`
+ * (`stride` suele ser el número de entidades del lote, pero puede ser mayor
+ * para avanzar solo un trozo de un lote más grande). Las entidades con
+ * menos candidatos se rellenan con `PHYSICS_NO_FLOOR_LEFT` y
+ * `PHYSICS_NO_FLOOR_RIGHT`, que no se cruzan nunca.
+ */
+struct PhysicsFloors {
+    const int* left;
+    const int* right;
+    const int* top;
+    int        rounds;
+    int        stride;  ///< Distancia entre rondas (al menos el n del lote)
+};
+
+const int PHYSICS_NO_FLOOR_LEFT = 2147483647;
+const int PHYSICS_NO_FLOOR_RIGHT = -2147483647 - 1;
+
+/**
+ * @brief Avanza un paso todas las entidades del lote: gravedad, movimiento,
+ * aterrizaje sobre los suelos candidatos y media vuelta al quedarse sin suelo
+ * (la patrulla de los enemigos).
+ *
+ * Una entidad aterriza en un suelo si lo cruza hacia abajo (ver
+ * `Platform::has_crossed_floor_downwards`); los suelos se prueban en orden de
+ * ronda y cada uno ve la posición ya corregida por los anteriores.
+ *
+ * Usa instrucciones AVX2 o SSE2 si el procesador las tiene (se decide en tiempo
+ * de ejecución) y `physics_step_scalar` en el resto de casos. Todas las
+ * versiones dan exactamente el mismo resultado.
+ */
+void physics_step(PhysicsBatch batch, PhysicsFloors floors);
+
+/**
+ * @brief Versión de referencia de `physics_step`: una entidad cada vez.
+ */
+void physics_step_scalar(PhysicsBatch batch, PhysicsFloors floors);
+
+/**
+ * @brief Ejecuta la implementación `impl` ("avx2", "sse2" o "scalar") de
+ * `physics_step`, aunque no sea la que se usa normalmente, para poder
+ * comprobar que todas dan el mismo resultado.
+ *
+ * @return false (sin tocar el lote) si este procesador no la tiene.
+ */
+bool physics_step_with(const char* impl, PhysicsBatch batch, PhysicsFloors floors);
+
+/**
+ * @brief Nombre de la implementación que usa `physics_step` ("avx2", "sse2" o "scalar").
+ */
+const char* physics_step_impl();
+
+}  // namespace pro2
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef CONCURRENT_FINDER_HH
+#define CONCURRENT_FINDER_HH
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "geometry.hh"
+#include "static_finder.hh"
+
+// Índice espacial para consultar desde varios hilos mientras otro hilo
+// mueve los objetos (p.ej. pintar en un hilo y simular en otro).
+//
+// Un único hilo escritor modifica los objetos con add/update/remove, que
+// solo tocan una copia privada, y al acabar el frame llama a publish(): se
+// construye una instantánea inmutable (un StaticFinder) y se publica con un
+// intercambio atómico. Los lectores consultan siempre una instantánea
+// completa a través de un Reader, sin ningún lock: solo anuncian en una
+// variable atómica propia la época en la que han empezado a leer.
+//
+// Las instantáneas antiguas no se liberan mientras algún lector que pudo
+// verlas siga dentro de una consulta (reclamación por épocas): publish()
+// libera las que ya no puede estar leyendo nadie.
+template <class T, class Key = const T*>
+class ConcurrentFinder {
+public:
+    using key_type = Key;
+
+    static constexpr int DEFAULT_CELL_SIZE = StaticFinder<T>::DEFAULT_CELL_SIZE;
+
+    // Número máximo de Readers vivos a la vez
+    static constexpr int MAX_READERS = 64;
+
+private:
+    // Objeto tal como quedó en la instantánea
+    struct Item {
+        Key        key;
+        pro2::Rect rect;
+
+        pro2::Rect get_rect() const {
+            return rect;
+        }
+    };
+
+    // Contenido inmutable de una versión publicada. `index` apunta a los
+    // elementos de `items`, así que una instantánea nunca se copia ni se mueve.
+    struct Snapshot {
+        std::vector<Item>  items;
+        StaticFinder<Item> index;
+        unsigned long long version;
+
+        Snapshot(int cell_size, unsigned long long v) : index(cell_size), version(v) {}
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+    };
+
+    // Época anunciada por un lector: 0 si no está consultando. Cada una en
+    // su propia línea de caché para que los lectores no se estorben.
+    struct alignas(64) ReaderSlot {
+        std::atomic<unsigned long long> epoch{0};
+        std::atomic<bool>               used{false};
+    };
+
+    struct Retired {
+        const Snapshot*    snapshot;
+        unsigned long long epoch;  // Época a partir de la cual nadie la ve
+    };
+
+    int cell_size_;
+
+    // Estado del escritor
+    std::unordered_map<Key, pro2::Rect> objects_;
+    bool                                changed_ = false;
+    unsigned long long                  version_ = 0;
+    std::vector<Retired>                retired_;
+
+    // Estado compartido con los lectores
+    std::atomic<const Snapshot*>    current_;
+    std::atomic<unsigned long long> epoch_{1};
+    mutable ReaderSlot              readers_[MAX_READERS];
+
+    // Liberar las instantáneas retiradas que ya no puede estar leyendo
+    // ningún lector: las retiradas en una época anterior o igual a la más
+    // antigua que tiene anunciada algún lector activo.
+    void collect() {
+        unsigned long long oldest = 0;
+        for (const ReaderSlot& r : readers_) {
+            const unsigned long long e = r.epoch.load();
+            if (e != 0 && (oldest == 0 || e < oldest)) {
+                oldest = e;
+            }
+        }
+        size_t kept = 0;
+        for (const Retired& r : retired_) {
+            if (oldest == 0 || r.epoch <= oldest) {
+                delete r.snapshot;
+            } else {
+                retired_[kept++] = r;
+            }
+        }
+        retired_.resize(kept);
+    }
+
+public:
+    // Acceso de lectura desde un hilo. Cada hilo lector usa su propio
+    // Reader; las consultas de un Reader ven siempre una única instantánea
+    // completa. El Reader no debe vivir más que el ConcurrentFinder.
+    class Reader {
+        const ConcurrentFinder* owner_;
+        ReaderSlot*             slot_;
+
+        // Llamar a fn(instantánea) con la instantánea actual protegida
+        template <class Fn>
+        auto read(Fn fn) const -> decltype(fn(std::declval<const Snapshot&>())) {
+            // Anunciar la época antes de leer el puntero (ambos seq_cst):
+            // si el escritor no ve el anuncio, es que este lector leerá una
+            // instantánea publicada después de su recorrido
+            slot_->epoch.store(owner_->epoch_.load());
+            const Snapshot* s = owner_->current_.load();
+            struct Leave {
+                ReaderSlot* slot;
+                ~Leave() {
+                    slot->epoch.store(0, std::memory_order_release);
+                }
+            } leave{slot_};
+            return fn(*s);
+        }
+
+    public:
+        // Lanza std::length_error si ya hay MAX_READERS Readers vivos
+        explicit Reader(const ConcurrentFinder& owner) : owner_(&owner), slot_(nullptr) {
+            for (ReaderSlot& slot : owner.readers_) {
+                bool expected = false;
+                if (slot.used.compare_exchange_strong(expected, true)) {
+                    slot_ = &slot;
+                    break;
+                }
+            }
+            if (slot_ == nullptr) {
+                throw std::length_error("Demasiados ConcurrentFinder::Reader a la vez");
+            }
+        }
+
+        ~Reader() {
+            slot_->used.store(false, std::memory_order_release);
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        // Versión de la última instantánea publicada
+        unsigned long long version() const {
+            return read([](const Snapshot& s) { return s.version; });
+        }
+
+        // Número de objetos de la última instantánea publicada
+        int size() const {
+            return read([](const Snapshot& s) { return static_cast<int>(s.items.size()); });
+        }
+
+        // Llamar a fn(Key) para cada objeto que intersecta qrect.
+        // fn no debe bloquearse esperando al escritor ni consultar otra vez
+        // este mismo Reader.
+        template <class Fn>
+        void for_each_in(pro2::Rect qrect, Fn fn) const {
+            read([&](const Snapshot& s) {
+                s.index.for_each_in(qrect, [&](const Item* item) { fn(item->key); });
+            });
+        }
+
+        // Indica si algún objeto que intersecta qrect cumple pred(Key)
+        template <class Pred>
+        bool any_in(pro2::Rect qrect, Pred pred) const {
+            return read([&](const Snapshot& s) {
+                return s.index.any_in(qrect, [&](const Item* item) { return bool(pred(item->key)); });
+            });
+        }
+
+        // Consultar objetos que intersectan con un rectángulo, escribiendo
+        // el resultado en un vector del llamador (se vacía primero)
+        void query(pro2::Rect qrect, std::vector<Key>& result) const {
+            result.clear();
+            for_each_in(qrect, [&](Key key) { result.push_back(key); });
+        }
+
+        // Consultar objetos que intersectan con un rectángulo
+        std::set<Key> query(pro2::Rect qrect) const {
+            std::vector<Key> found;
+            query(qrect, found);
+            return std::set<Key>(found.begin(), found.end());
+        }
+    };
+
+    // Constructor: índice vacío (con una instantánea vacía ya publicada)
+    explicit ConcurrentFinder(int cell_size = DEFAULT_CELL_SIZE)
+        : cell_size_(std::max(1, cell_size)), current_(new Snapshot(cell_size_, 0)) {}
+
+    ConcurrentFinder(const ConcurrentFinder&) = delete;
+    ConcurrentFinder& operator=(const ConcurrentFinder&) = delete;
+
+    // No debe quedar ningún Reader vivo
+    ~ConcurrentFinder() {
+        for (const Retired& r : retired_) {
+            delete r.snapshot;
+        }
+        delete current_.load();
+    }
+
+    // Número de instantáneas retiradas que aún no se han podido liberar
+    int retired_count() const {
+        return static_cast<int>(retired_.size());
+    }
+
+    // Versión de la última instantánea publicada por el escritor
+    unsigned long long version() const {
+        return version_;
+    }
+
+    // --- Escritor (un solo hilo) ---
+
+    // Añadir o mover un objeto. No se ve en las consultas hasta publish().
+    void add(Key key, pro2::Rect rect) {
+        objects_[key] = rect;
+        changed_ = true;
+    }
+
+    // Añadir un objeto (claves que son punteros al objeto)
+    void add(Key key) {
+        add(key, key->get_rect());
+    }
+
+    // Actualizar la posición de un objeto. No se ve hasta publish().
+    void update(Key key, pro2::Rect rect) {
+        auto it = objects_.find(key);
+        if (it == objects_.end()) {
+            add(key, rect);
+        } else if (it->second.left != rect.left || it->second.top != rect.top ||
+                   it->second.right != rect.right || it->second.bottom != rect.bottom) {
+            it->second = rect;
+            changed_ = true;
+        }
+    }
+
+    // Actualizar la posición de un objeto (claves que son punteros al objeto)
+    void update(Key key) {
+        update(key, key->get_rect());
+    }
+
+    // Remover un objeto. Sigue apareciendo en las consultas hasta publish().
+    void remove(Key key) {
+        if (objects_.erase(key) != 0) {
+            changed_ = true;
+        }
+    }
+
+    // Publicar el estado actual para los lectores (al final de cada frame).
+    // Si nada ha cambiado desde la última publicación no hace nada.
+    void publish() {
+        if (changed_) {
+            changed_ = false;
+            Snapshot* s = new Snapshot(cell_size_, ++version_);
+            s->items.reserve(objects_.size());
+            for (const auto& obj : objects_) {
+                s->items.push_back({obj.first, obj.second});
+            }
+            s->index.build(s->items);
+            const Snapshot* old = current_.exchange(s);
+            retired_.push_back({old, ++epoch_});
+        }
+        collect();
+    }
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "enemy.hh"
 #include "utils.hh"
+#include <algorithm>
 #include <cmath>
 
 using namespace pro2;
@@ -12,7 +13,7 @@ const int W = 0xFFFFFF;  // Blanco (ojos)
 const int K = 0x000000;  // Negro (pupilas)
 
 // Sprite del Goomba (12x12)
-const std::vector<std::vector<int>> Enemy::goomba_sprite_ = {
+const std::vector<std::vector<int>> EnemyPool::goomba_sprite_ = {
     {_, _, _, B, B, B, B, B, B, _, _, _},
     {_, _, B, B, B, B, B, B, B, B, _, _},
     {_, B, B, B, B, B, B, B, B, B, B, _},
@@ -27,62 +28,179 @@ const std::vector<std::vector<int>> Enemy::goomba_sprite_ = {
     {_, _, D, D, D, D, D, D, D, D, _, _},
 };
 
-Enemy::Enemy(Pt pos, Type type)
-    : pos_(pos), speed_{-2, 0}, type_(type), 
-      alive_(true), moving_left_(true), animation_frame_(0) {}
+void EnemyPool::reserve(int n) {
+    x_.reserve(n);
+    y_.reserve(n);
+    vx_.reserve(n);
+    vy_.reserve(n);
+    type_.reserve(n);
+    animation_frame_.reserve(n);
+    last_frame_.reserve(n);
+    id_.reserve(n);
+}
 
-void Enemy::update(const std::vector<Platform>& platforms) {
-    if (!alive_) return;
+EnemyPool::Handle EnemyPool::add(Pt pos, Type type) {
+    std::uint32_t id;
+    if (free_ids_.empty()) {
+        id = static_cast<std::uint32_t>(generation_.size());
+        index_of_.push_back(0);
+        generation_.push_back(0);
+        is_moved_.push_back(0);
+    } else {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+    }
+    index_of_[id] = static_cast<std::uint32_t>(size());
+    x_.push_back(pos.x);
+    y_.push_back(pos.y);
+    vx_.push_back(-2);
+    vy_.push_back(0);
+    type_.push_back(type);
+    animation_frame_.push_back(0);
+    last_frame_.push_back(0);
+    id_.push_back(id);
+    return (Handle(generation_[id]) << 32) | id;
+}
+
+void EnemyPool::remove(Handle h) {
+    if (!valid(h)) return;
+    const std::uint32_t id = id_of(h);
+    const int i = index(h);
+    const int last = size() - 1;
     
-    animation_frame_++;
+    // Mover el último enemigo al hueco
+    x_[i] = x_[last];
+    y_[i] = y_[last];
+    vx_[i] = vx_[last];
+    vy_[i] = vy_[last];
+    type_[i] = type_[last];
+    animation_frame_[i] = animation_frame_[last];
+    last_frame_[i] = last_frame_[last];
+    id_[i] = id_[last];
+    index_of_[id_[i]] = i;
     
-    // Aplicar gravedad
-    speed_.y += 1;  // Gravedad
+    x_.pop_back();
+    y_.pop_back();
+    vx_.pop_back();
+    vy_.pop_back();
+    type_.pop_back();
+    animation_frame_.pop_back();
+    last_frame_.pop_back();
+    id_.pop_back();
     
-    // Actualizar posición
-    Pt old_pos = pos_;
-    pos_.x += speed_.x;
-    pos_.y += speed_.y;
+    // Invalidar los Handles que apuntan a este identificador
+    index_of_[id] = free_index;
+    generation_[id]++;
+    free_ids_.push_back(id);
     
-    // Comprobar colisiones con plataformas
-    bool grounded = false;
-    for (const Platform& platform : platforms) {
-        if (platform.has_crossed_floor_downwards(old_pos, pos_)) {
-            pos_.y = platform.top();
-            speed_.y = 0;
-            grounded = true;
+    // Un enemigo borrado ya no se ha movido: take_moved() solo devuelve
+    // enemigos que siguen en el pool
+    if (is_moved_[id]) {
+        is_moved_[id] = 0;
+        moved_.erase(std::find(moved_.begin(), moved_.end(), id));
+    }
+}
+
+pro2::Rect EnemyPool::next_step_bounds(int i) const {
+    // Mismo movimiento que step(): gravedad y luego velocidad
+    Pt next = {x_[i] + vx_[i], y_[i] + vy_[i] + 1};
+    return {std::min(x_[i], next.x), std::min(y_[i], next.y),
+            std::max(x_[i], next.x), std::max(y_[i], next.y)};
+}
+
+template <class PlatformsOf>
+void EnemyPool::load_floors(int begin, int end, int n, int rounds, PlatformsOf platforms_of) {
+    for (int k = begin; k < end; ++k) {
+        const std::vector<const Platform*>& platforms = platforms_of(k);
+        for (int j = 0; j < rounds; ++j) {
+            if (j < static_cast<int>(platforms.size())) {
+                const Rect r = platforms[j]->get_rect();
+                floor_left_[j * n + k] = r.left;
+                floor_right_[j * n + k] = r.right;
+                floor_top_[j * n + k] = r.top;
+            } else {
+                floor_left_[j * n + k] = PHYSICS_NO_FLOOR_LEFT;
+                floor_right_[j * n + k] = PHYSICS_NO_FLOOR_RIGHT;
+                floor_top_[j * n + k] = 0;
+            }
         }
     }
-    
-    // Si no está en el suelo o choca con algo, girar
-    if (!grounded && old_pos.y <= pos_.y) {
-        // No hay suelo debajo, girar
-        speed_.x = -speed_.x;
-        moving_left_ = !moving_left_;
+}
+
+void EnemyPool::step(int i, const std::vector<const Platform*>& platforms) {
+    // Un lote de un solo enemigo, directamente sobre sus campos
+    const int rounds = static_cast<int>(platforms.size());
+    floor_left_.resize(rounds);
+    floor_right_.resize(rounds);
+    floor_top_.resize(rounds);
+    load_floors(0, 1, 1, rounds, [&](int) -> const std::vector<const Platform*>& {
+        return platforms;
+    });
+    animation_frame_[i]++;
+    physics_step_scalar({&x_[i], &y_[i], &vx_[i], &vy_[i], 1},
+                        {floor_left_.data(), floor_right_.data(), floor_top_.data(), rounds, 1});
+    note_moved(i);
+}
+
+void EnemyPool::step(const std::vector<int>&                       indices,
+                     const std::vector<std::vector<const Platform*>>& platforms,
+                     JobSystem&                                     jobs,
+                     int                                            grain) {
+    const int n = static_cast<int>(indices.size());
+    size_t    max_platforms = 0;
+    for (const std::vector<const Platform*>& p : platforms) {
+        max_platforms = std::max(max_platforms, p.size());
     }
+    const int rounds = static_cast<int>(max_platforms);
+    batch_x_.resize(n);
+    batch_y_.resize(n);
+    batch_vx_.resize(n);
+    batch_vy_.resize(n);
+    floor_left_.resize(size_t(rounds) * n);
+    floor_right_.resize(size_t(rounds) * n);
+    floor_top_.resize(size_t(rounds) * n);
     
-    // Detectar colisión con bordes de plataformas (simplificado)
-    // Si se mueve demasiado hacia abajo, probablemente se cayó del borde
-    if (pos_.y > old_pos.y + 20) {
-        speed_.x = -speed_.x;
-        moving_left_ = !moving_left_;
-        pos_.x = old_pos.x;
+    // Cada trozo copia sus enemigos a columnas contiguas, los avanza todos
+    // a la vez y los devuelve a su sitio. Los trozos no comparten
+    // posiciones, así que pueden ir en paralelo.
+    jobs.parallel_for(n, grain, [&](int begin, int end, int) {
+        for (int k = begin; k < end; ++k) {
+            const int i = indices[k];
+            batch_x_[k] = x_[i];
+            batch_y_[k] = y_[i];
+            batch_vx_[k] = vx_[i];
+            batch_vy_[k] = vy_[i];
+        }
+        load_floors(begin, end, n, rounds, [&](int k) -> const std::vector<const Platform*>& {
+            return platforms[k];
+        });
+        physics_step({batch_x_.data() + begin, batch_y_.data() + begin, batch_vx_.data() + begin,
+                      batch_vy_.data() + begin, end - begin},
+                     {floor_left_.data() + begin, floor_right_.data() + begin, floor_top_.data() + begin,
+                      rounds, n});
+        for (int k = begin; k < end; ++k) {
+            const int i = indices[k];
+            x_[i] = batch_x_[k];
+            y_[i] = batch_y_[k];
+            vx_[i] = batch_vx_[k];
+            vy_[i] = batch_vy_[k];
+            animation_frame_[i]++;
+        }
+    });
+    // Anotarlos después, en serie: la lista es compartida
+    for (int i : indices) {
+        note_moved(i);
     }
 }
 
-void Enemy::paint(pro2::Window& window) const {
-    if (!alive_) return;
-    
-    const Pt top_left = {pos_.x - sprite_width/2, pos_.y - sprite_height/2};
-    paint_sprite(window, top_left, goomba_sprite_, !moving_left_);
+void EnemyPool::paint(int i, pro2::Window& window) const {
+    const Pt top_left = {x_[i] - sprite_width/2, y_[i] - sprite_height/2};
+    paint_sprite(window, top_left, goomba_sprite_, vx_[i] >= 0);
 }
 
-bool Enemy::check_collision_with_mario(Pt mario_pos, bool& jumped_on) {
-    if (!alive_) return false;
-    
-    Rect enemy_rect = get_rect();
-    Rect mario_rect = {mario_pos.x - 6, mario_pos.y - 15, 
-                       mario_pos.x + 6, mario_pos.y + 1};
+bool EnemyPool::check_collision_with_mario(int i, Pt mario_pos, bool& jumped_on) const {
+    Rect enemy_rect = rect(i);
+    Rect mario_rect = mario_hit_rect(mario_pos);
     
     // Verificar intersección
     bool intersects = !(enemy_rect.right < mario_rect.left || 
@@ -93,9 +211,9 @@ bool Enemy::check_collision_with_mario(Pt mario_pos, bool& jumped_on) {
     if (intersects) {
         // Determinar si Mario saltó sobre el enemigo
         // Si Mario está cayendo y su posición está por encima del centro del enemigo
-        jumped_on = (mario_pos.y < pos_.y - sprite_height/4);
+        jumped_on = (mario_pos.y < y_[i] - sprite_height/4);
         return true;
     }
     
     return false;
-}
\ No newline at end of file
+}
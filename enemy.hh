@@ -3,46 +3,191 @@
 
 #include "window.hh"
 #include "platform.hh"
+#include "batch_physics.hh"
+#include "job_system.hh"
+#include <cstdint>
 #include <vector>
 
-class Enemy {
+// Todos los enemigos del nivel, guardados como structure-of-arrays: cada
+// campo (posición, velocidad, tipo, animación...) en su propio vector
+// contiguo, de forma que los bucles que recorren muchos enemigos leen
+// memoria seguida en lugar de saltar de nodo en nodo.
+//
+// Dentro del pool los enemigos ocupan los índices 0..size()-1 y al borrar
+// uno se mueve el último a su hueco, así que el índice de un enemigo puede
+// cambiar. Para referirse a un enemigo de un frame a otro (p.ej. como clave
+// del Finder) se usa su Handle, que no cambia nunca: guarda un identificador
+// y su generación, y deja de ser válido cuando se borra el enemigo aunque el
+// identificador se reutilice para otro.
+//
+// El pool anota él mismo qué enemigos mueve (step()), para que quien los
+// tenga en un índice espacial los recoja con take_moved() sin tener que
+// saber qué operaciones mueven a un enemigo.
+class EnemyPool {
 public:
-    enum Type {
+    enum Type : std::uint8_t {
         GOOMBA,
         KOOPA
     };
 
+    // Generación en los 32 bits altos, identificador en los bajos
+    using Handle = std::uint64_t;
+
+    // Estado del que depende el movimiento: dos enemigos con el mismo
+    // estado se moverán igual a partir de ahora
+    struct Motion {
+        pro2::Pt pos;
+        pro2::Pt speed;
+
+        bool operator==(const Motion& o) const {
+            return pos.x == o.pos.x && pos.y == o.pos.y &&
+                   speed.x == o.speed.x && speed.y == o.speed.y;
+        }
+    };
+
+    static constexpr int sprite_width = 12;
+    static constexpr int sprite_height = 12;
+
 private:
-    pro2::Pt pos_;
-    pro2::Pt speed_;
-    Type type_;
-    bool alive_;
-    bool moving_left_;
-    int animation_frame_;
+    // Campos de cada enemigo, por índice
+    std::vector<int>          x_, y_;
+    std::vector<int>          vx_, vy_;  // El enemigo mira a la izquierda si vx < 0
+    std::vector<Type>         type_;
+    std::vector<int>          animation_frame_;
+    std::vector<int>          last_frame_;  // Último frame simulado (ver Game::update_enemies)
+    std::vector<std::uint32_t> id_;         // Identificador de cada índice
+
+    // Por identificador: índice actual (free_index si está libre) y generación
+    static constexpr std::uint32_t free_index = 0xFFFFFFFFu;
+    std::vector<std::uint32_t> index_of_;
+    std::vector<std::uint32_t> generation_;
+    std::vector<std::uint32_t> free_ids_;
+
+    // Identificadores movidos desde el último take_moved(), sin repetidos
+    std::vector<std::uint32_t> moved_;
+    std::vector<std::uint8_t>  is_moved_;  // Por identificador
+
+    // Buffers de step(): el lote de enemigos y sus suelos candidatos en el
+    // formato de physics_step
+    std::vector<int> batch_x_, batch_y_, batch_vx_, batch_vy_;
+    std::vector<int> floor_left_, floor_right_, floor_top_;
+    
+    // Preparar en floor_* los suelos de los enemigos [begin, end) de un
+    // lote de n; platforms_of(k) son las plataformas candidatas del enemigo
+    // k. El número de rondas (rounds) ya debe estar decidido.
+    template <class PlatformsOf>
+    void load_floors(int begin, int end, int n, int rounds, PlatformsOf platforms_of);
     
     // Sprite del Goomba
     static const std::vector<std::vector<int>> goomba_sprite_;
-    static constexpr int sprite_width = 12;
-    static constexpr int sprite_height = 12;
-    
+
+    static std::uint32_t id_of(Handle h) {
+        return static_cast<std::uint32_t>(h);
+    }
+
+    // Anotar que el enemigo i se ha movido
+    void note_moved(int i) {
+        const std::uint32_t id = id_[i];
+        if (!is_moved_[id]) {
+            is_moved_[id] = 1;
+            moved_.push_back(id);
+        }
+    }
+
 public:
-    Enemy(pro2::Pt pos, Type type = GOOMBA);
-    
-    void update(const std::vector<Platform>& platforms);
-    void paint(pro2::Window& window) const;
-    
+    int size() const {
+        return static_cast<int>(x_.size());
+    }
+
+    // Reservar memoria para n enemigos
+    void reserve(int n);
+
+    // Añadir un enemigo y devolver su Handle
+    Handle add(pro2::Pt pos, Type type = GOOMBA);
+
+    // Indica si h es un enemigo que sigue en el pool
+    bool valid(Handle h) const {
+        const std::uint32_t id = id_of(h);
+        return id < generation_.size() && generation_[id] == (h >> 32) && index_of_[id] != free_index;
+    }
+
+    // Índice actual del enemigo h (que debe ser válido)
+    int index(Handle h) const {
+        return static_cast<int>(index_of_[id_of(h)]);
+    }
+
+    Handle handle(int i) const {
+        return (Handle(generation_[id_[i]]) << 32) | id_[i];
+    }
+
+    // Borrar un enemigo: el último pasa a ocupar su índice
+    void remove(Handle h);
+
+    pro2::Pt pos(int i) const {
+        return {x_[i], y_[i]};
+    }
+
+    Motion motion(int i) const {
+        return {{x_[i], y_[i]}, {vx_[i], vy_[i]}};
+    }
+
     // Rectángulo de colisión
-    pro2::Rect get_rect() const {
-        return {pos_.x - sprite_width/2, pos_.y - sprite_height/2,
-                pos_.x + sprite_width/2, pos_.y + sprite_height/2};
+    pro2::Rect rect(int i) const {
+        return {x_[i] - sprite_width/2, y_[i] - sprite_height/2,
+                x_[i] + sprite_width/2, y_[i] + sprite_height/2};
     }
-    
-    pro2::Pt pos() const { return pos_; }
-    bool is_alive() const { return alive_; }
-    void kill() { alive_ = false; }
-    
-    // Verifica colisión con Mario
-    bool check_collision_with_mario(pro2::Pt mario_pos, bool& jumped_on);
+
+    int last_frame(int i) const {
+        return last_frame_[i];
+    }
+
+    void set_last_frame(int i, int frame) {
+        last_frame_[i] = frame;
+    }
+
+    // Contar `frames` pasos que no se han simulado uno a uno
+    void skip_frames(int i, int frames) {
+        animation_frame_[i] += frames;
+    }
+
+    // Caja que recorrerán los pies del enemigo en el próximo paso: solo las
+    // plataformas que la tocan pueden pararlo
+    pro2::Rect next_step_bounds(int i) const;
+
+    // Avanzar un paso el enemigo i; `platforms` son las plataformas
+    // cercanas, sin copiarlas
+    void step(int i, const std::vector<const Platform*>& platforms);
+
+    // Llamar a fn(handle) una vez por cada enemigo que se ha movido desde la
+    // última llamada (y que sigue en el pool), en el orden en que se
+    // movieron por primera vez, y vaciar la lista
+    template <class Fn>
+    void take_moved(Fn fn) {
+        for (std::uint32_t id : moved_) {
+            is_moved_[id] = 0;
+            fn((Handle(generation_[id]) << 32) | id);
+        }
+        moved_.clear();
+    }
+
+    // Avanzar un paso los enemigos `indices` (sin repetidos), todos a la vez
+    // (ver physics_step) y repartidos en trozos de `grain` enemigos entre
+    // los hilos de `jobs`; platforms[k] son las plataformas cercanas a
+    // indices[k]
+    void step(const std::vector<int>&                       indices,
+              const std::vector<std::vector<const Platform*>>& platforms,
+              JobSystem&                                     jobs,
+              int                                            grain);
+
+    void paint(int i, pro2::Window& window) const;
+
+    // Rectángulo de Mario que se usa en las colisiones con enemigos
+    static pro2::Rect mario_hit_rect(pro2::Pt mario_pos) {
+        return {mario_pos.x - 6, mario_pos.y - 15, mario_pos.x + 6, mario_pos.y + 1};
+    }
+
+    // Verifica colisión del enemigo i con Mario
+    bool check_collision_with_mario(int i, pro2::Pt mario_pos, bool& jumped_on) const;
 };
 
 #endif
@@ -3,130 +3,812 @@
 
 #include <vector>
 #include <set>
-#include <map>
+#include <unordered_map>
+#include <memory_resource>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
 #include "geometry.hh"
+#include "finder_stats.hh"
+#include "rect_filter.hh"
+#include "small_vector.hh"
+#include "sweep.hh"
 
-template <class T>
+// Configuración de un Finder en tiempo de compilación, para adaptar el
+// índice al tamaño y la densidad de cada tipo de objeto:
+//
+// - CellShift: si es mayor que 0 las celdas miden 2^CellShift píxels y la
+//   celda de una coordenada se calcula con un desplazamiento en lugar de una
+//   división (el tamaño que se pasa al constructor se ignora). Con 0 el
+//   tamaño se elige al construir el Finder.
+// - Coord: tipo de las copias de las coordenadas que guardan las celdas, int
+//   o int16_t. Con int16_t las celdas ocupan la mitad y cada instrucción de
+//   filter_rects compara el doble de rectángulos. Las coordenadas que no
+//   caben en 16 bits se guardan recortadas y los candidatos recortados se
+//   comprueban con su rectángulo completo: el resultado es el mismo, pero
+//   es más lento, así que conviene que casi todo quepa.
+// - InlineCapacity: objetos que caben en cada celda sin reservar memoria
+//   aparte (ver SmallVector).
+template <int CellShift = 0, class Coord = int, int InlineCapacity = 0>
+struct FinderConfig {
+    static_assert(CellShift >= 0 && CellShift < 31, "CellShift fuera de rango");
+    static_assert(std::is_same<Coord, int>::value || std::is_same<Coord, std::int16_t>::value,
+                  "Coord tiene que ser int o int16_t");
+    static_assert(InlineCapacity >= 0, "InlineCapacity negativa");
+
+    static constexpr int cell_shift = CellShift;
+    using coord_type = Coord;
+    static constexpr int inline_capacity = InlineCapacity;
+};
+
+// Índice espacial de objetos de tipo T.
+//
+// Cada objeto se identifica por una clave `Key`, que es lo que devuelven las
+// consultas. Por defecto la clave es un puntero al objeto, pero puede ser
+// cualquier identificador estable con hash (p.ej. la posición del objeto en
+// el vector que lo contiene): así el llamador pasa directamente del
+// resultado de una consulta al objeto para modificarlo, y el índice no se
+// queda con punteros colgantes si el contenedor se redimensiona. Con claves
+// que no son punteros el rectángulo se pasa explícitamente a add()/update().
+//
+// Toda la memoria del índice (celdas, entradas y tablas hash) se pide al
+// std::pmr::memory_resource que se pasa al constructor. Con un arena por
+// nivel (p.ej. un monotonic_buffer_resource) el índice entero se libera de
+// golpe al descargar el nivel, y sus nodos no se mezclan con el resto del
+// heap. El recurso tiene que vivir más que el Finder.
+//
+// `Config` es una FinderConfig con el tamaño de celda, el tipo de
+// coordenadas y la capacidad de las celdas fijados en compilación.
+template <class T, class Key = const T*, class Config = FinderConfig<>>
 class Finder {
+public:
+    using key_type = Key;
+    using config_type = Config;
+
+    // Tamaño de celda por defecto (en píxels)
+    static constexpr int DEFAULT_CELL_SIZE = 1000;
+
+    // Contadores de las llamadas a update()
+    struct UpdateStats {
+        long long updates = 0;        // Llamadas a update() de objetos ya registrados
+        long long noop_updates = 0;   // Updates que no cambiaron de celdas
+        long long cells_touched = 0;  // Celdas en las que se ha insertado o borrado
+    };
+
+    // Resultado de nearest() y within(): el objeto y el cuadrado de su
+    // distancia (euclídea) al punto de consulta
+    struct Neighbor {
+        Key       key;
+        long long dist2;
+    };
+
 private:
-    // Configuración del grid espacial
-    static constexpr int SPACE_SIZE = 20000;
-    static constexpr int CELL_SIZE = 1000;  // Tamaño de cada celda
-    static constexpr int GRID_DIM = SPACE_SIZE / CELL_SIZE; // 20x20 celdas
-    
-    // Grid: matriz 2D de sets de punteros a objetos
-    // Cada celda contiene los objetos que la intersectan
-    std::vector<std::vector<std::set<const T*>>> grid_;
-    
-    // Mapa para recordar el rectángulo de cada objeto
-    // Necesario para update() y remove()
-    std::map<const T*, pro2::Rect> object_rects_;
-    
-    // Obtener las coordenadas de celda (cx, cy) para un punto (x, y)
-    std::pair<int, int> get_cell(int x, int y) const {
-        int cx = std::max(0, std::min(x / CELL_SIZE, GRID_DIM - 1));
-        int cy = std::max(0, std::min(y / CELL_SIZE, GRID_DIM - 1));
-        return {cx, cy};
-    }
-    
-    // Obtener todas las celdas que un rectángulo intersecta
-    std::vector<std::pair<int, int>> get_cells(pro2::Rect rect) const {
-        std::pair<int, int> min_cell = get_cell(rect.left, rect.top);
-        std::pair<int, int> max_cell = get_cell(rect.right, rect.bottom);
-        
-        std::vector<std::pair<int, int>> cells;
-        for (int cy = min_cell.second; cy <= max_cell.second; ++cy) {
-            for (int cx = min_cell.first; cx <= max_cell.first; ++cx) {
-                cells.push_back({cx, cy});
+    // Rango de celdas (límites incluidos) que cubre un rectángulo
+    struct CellRange {
+        int x0, y0, x1, y1;
+
+        bool contains(int cx, int cy) const {
+            return x0 <= cx && cx <= x1 && y0 <= cy && cy <= y1;
+        }
+
+        bool operator==(const CellRange& o) const {
+            return x0 == o.x0 && y0 == o.y0 && x1 == o.x1 && y1 == o.y1;
+        }
+    };
+
+    // Datos de cada objeto registrado. Las celdas guardan el índice de la
+    // entrada (slot) en lugar del puntero, y `stamp` permite descartar
+    // duplicados en una consulta sin construir ningún set.
+    // `rect` es el rectángulo del objeto la última vez que se sincronizó.
+    struct Entry {
+        Key              key;
+        pro2::Rect       rect;
+        CellRange        cells;
+        mutable unsigned stamp;
+        bool             live;   // El slot está ocupado
+        bool             dirty;  // Ya está en la cola dirty_
+    };
+
+    // Contenido de una celda en formato SoA: el slot de cada objeto y una
+    // copia de las coordenadas de su rectángulo en arrays separados, para
+    // filtrar los candidatos con instrucciones vectoriales (filter_rects)
+    // sin tener que ir a buscar el rectángulo de cada uno.
+    using Coord = typename Config::coord_type;
+
+    template <class V>
+    using Column = SmallVector<V, Config::inline_capacity>;
+
+    struct Cell {
+        using allocator_type = std::pmr::polymorphic_allocator<int>;
+
+        Column<int>   slots;
+        Column<Coord> left, top, right, bottom;
+
+        // Constructores con allocator: el unordered_map construye cada
+        // celda con su mismo memory_resource
+        explicit Cell(const allocator_type& a)
+            : slots(a), left(a), top(a), right(a), bottom(a) {}
+
+        Cell(const Cell& o, const allocator_type& a)
+            : slots(o.slots, a), left(o.left, a), top(o.top, a), right(o.right, a),
+              bottom(o.bottom, a) {}
+
+        Cell(Cell&& o, const allocator_type& a)
+            : slots(std::move(o.slots), a), left(std::move(o.left), a),
+              top(std::move(o.top), a), right(std::move(o.right), a),
+              bottom(std::move(o.bottom), a) {}
+
+        int size() const {
+            return static_cast<int>(slots.size());
+        }
+
+        int find(int slot) const {
+            const int* pos = std::find(slots.begin(), slots.end(), slot);
+            return pos == slots.end() ? -1 : static_cast<int>(pos - slots.begin());
+        }
+
+        void push(int slot, pro2::Rect r) {
+            slots.push_back(slot);
+            left.push_back(to_coord(r.left));
+            top.push_back(to_coord(r.top));
+            right.push_back(to_coord(r.right));
+            bottom.push_back(to_coord(r.bottom));
+        }
+
+        void set_rect(int i, pro2::Rect r) {
+            left[i] = to_coord(r.left);
+            top[i] = to_coord(r.top);
+            right[i] = to_coord(r.right);
+            bottom[i] = to_coord(r.bottom);
+        }
+
+        // Alguna coordenada del elemento i está en el límite de Coord, así
+        // que puede estar recortada (ver to_coord)
+        bool saturated(int i) const {
+            return at_limit(left[i]) || at_limit(top[i]) || at_limit(right[i]) ||
+                   at_limit(bottom[i]);
+        }
+
+        // Quitar el elemento i (intercambiándolo con el último, el orden
+        // dentro de una celda no importa)
+        void erase(int i) {
+            slots[i] = slots.back();
+            left[i] = left.back();
+            top[i] = top.back();
+            right[i] = right.back();
+            bottom[i] = bottom.back();
+            slots.pop_back();
+            left.pop_back();
+            top.pop_back();
+            right.pop_back();
+            bottom.pop_back();
+        }
+    };
+
+    // Tamaño de cada celda (fijo si Config::cell_shift > 0)
+    int cell_size_;
+
+    // Grid disperso: solo existen las celdas que alguna vez han contenido un
+    // objeto. La clave empaqueta las coordenadas de celda (cx, cy), de modo
+    // que el grid cubre cualquier coordenada (negativa o muy grande).
+    // Las celdas que se vacían se conservan para reutilizar su memoria
+    // cuando un objeto vuelve a entrar.
+    std::pmr::unordered_map<unsigned long long, Cell> cells_;
+
+    // Entradas de los objetos, indexadas por slot, y slots libres para reutilizar
+    std::pmr::vector<Entry> entries_;
+    std::pmr::vector<int>   free_slots_;
+
+    // Slot de cada objeto. Necesario para update() y remove()
+    std::pmr::unordered_map<Key, int> slots_;
+
+    // Slots de los objetos marcados con mark_dirty() pendientes de sync()
+    std::pmr::vector<int> dirty_;
+
+    // Marca de la consulta en curso (ver Entry::stamp)
+    mutable unsigned query_stamp_ = 0;
+
+    UpdateStats update_stats_;
+
+    // Se incrementa cada vez que cambia el contenido del índice
+    unsigned long long version_ = 0;
+
+#ifdef FINDER_STATS
+    mutable pro2::FinderQueryStats query_stats_;
+#endif
+
+    // Coordenada de celda de una coordenada del plano.
+    // Redondea hacia -infinito para que las coordenadas negativas no
+    // compartan la celda 0 con las positivas.
+    int cell_coord(int v) const {
+        if constexpr (Config::cell_shift > 0) {
+            // El desplazamiento aritmético ya redondea hacia -infinito
+            return v >> Config::cell_shift;
+        } else {
+            int c = v / cell_size_;
+            if (v % cell_size_ != 0 && v < 0) {
+                c--;
             }
+            return c;
         }
-        return cells;
     }
-    
+
+    // Empaquetar las coordenadas de una celda en una única clave
+    static unsigned long long cell_key(int cx, int cy) {
+        return (static_cast<unsigned long long>(static_cast<unsigned int>(cx)) << 32) |
+               static_cast<unsigned int>(cy);
+    }
+
     // Verificar si dos rectángulos intersectan
     // Los límites están incluidos en el rectángulo
     bool intersects(pro2::Rect a, pro2::Rect b) const {
         return !(a.right < b.left || a.left > b.right ||
                  a.bottom < b.top || a.top > b.bottom);
     }
-    
-public:
-    // Constructor: inicializa el grid vacío
-    Finder() : grid_(GRID_DIM, std::vector<std::set<const T*>>(GRID_DIM)) {}
-    
-    // Añadir un objeto al finder
-    void add(const T* t) {
-        pro2::Rect rect = t->get_rect();
-        object_rects_[t] = rect;
-        
-        // Añadir el objeto a todas las celdas que intersecta
-        std::vector<std::pair<int, int>> cells = get_cells(rect);
-        for (const auto& cell : cells) {
-            grid_[cell.second][cell.first].insert(t);
-        }
-    }
-    
-    // Actualizar la posición de un objeto
-    void update(const T* t) {
-        // Remover de las celdas del rectángulo viejo
-        auto it = object_rects_.find(t);
-        if (it != object_rects_.end()) {
-            pro2::Rect old_rect = it->second;
-            std::vector<std::pair<int, int>> old_cells = get_cells(old_rect);
-            for (const auto& cell : old_cells) {
-                grid_[cell.second][cell.first].erase(t);
+
+    // Con coordenadas compactas, recortar al rango de Coord. Recortar no
+    // cambia el orden entre dos coordenadas, solo puede igualarlas en un
+    // límite; filter_cell recorta igual la consulta, así que no se pierde
+    // ningún resultado y solo pueden sobrar elementos con alguna coordenada
+    // en el límite.
+    static Coord to_coord(int v) {
+        using Limits = std::numeric_limits<Coord>;
+        return static_cast<Coord>(std::min<int>(std::max<int>(v, Limits::min()), Limits::max()));
+    }
+
+    static bool at_limit(Coord v) {
+        using Limits = std::numeric_limits<Coord>;
+        return v == Limits::min() || v == Limits::max();
+    }
+
+    CellRange cell_range(pro2::Rect rect) const {
+        return {cell_coord(rect.left), cell_coord(rect.top),
+                cell_coord(rect.right), cell_coord(rect.bottom)};
+    }
+
+    // Añadir el slot a las celdas de `range` que no están en `skip`, y
+    // actualizar la copia del rectángulo en las que sí están
+    void insert_in_cells(int slot, pro2::Rect rect, CellRange range,
+                         const CellRange* skip = nullptr) {
+        for (int cy = range.y0; cy <= range.y1; ++cy) {
+            for (int cx = range.x0; cx <= range.x1; ++cx) {
+                if (skip == nullptr || !skip->contains(cx, cy)) {
+                    cells_[cell_key(cx, cy)].push(slot, rect);
+                    update_stats_.cells_touched++;
+                } else {
+                    auto it = cells_.find(cell_key(cx, cy));
+                    if (it != cells_.end()) {
+                        int i = it->second.find(slot);
+                        if (i >= 0) {
+                            it->second.set_rect(i, rect);
+                        }
+                    }
+                }
             }
         }
-        
-        // Añadir a las celdas del rectángulo nuevo
-        pro2::Rect new_rect = t->get_rect();
-        object_rects_[t] = new_rect;
-        std::vector<std::pair<int, int>> new_cells = get_cells(new_rect);
-        for (const auto& cell : new_cells) {
-            grid_[cell.second][cell.first].insert(t);
+    }
+
+    // Quitar el slot de las celdas de `range` que no están en `keep`
+    void erase_from_cells(int slot, CellRange range, const CellRange* keep = nullptr) {
+        for (int cy = range.y0; cy <= range.y1; ++cy) {
+            for (int cx = range.x0; cx <= range.x1; ++cx) {
+                if (keep != nullptr && keep->contains(cx, cy)) {
+                    continue;
+                }
+                auto it = cells_.find(cell_key(cx, cy));
+                if (it == cells_.end()) {
+                    continue;
+                }
+                int i = it->second.find(slot);
+                if (i >= 0) {
+                    it->second.erase(i);
+                    update_stats_.cells_touched++;
+                }
+            }
         }
     }
-    
-    // Remover un objeto del finder
-    void remove(const T* t) {
-        auto it = object_rects_.find(t);
-        if (it != object_rects_.end()) {
-            pro2::Rect rect = it->second;
-            
-            // Remover de todas las celdas que intersectaba
-            std::vector<std::pair<int, int>> cells = get_cells(rect);
-            for (const auto& cell : cells) {
-                grid_[cell.second][cell.first].erase(t);
+
+    // Llamar a fn(slot) para cada elemento de la celda cuyo rectángulo
+    // intersecta qrect. Si fn devuelve true se detiene y devuelve true.
+    template <class Fn>
+    bool filter_cell(const Cell& cell, pro2::Rect qrect, Fn fn) const {
+        int       hits[pro2::RECT_FILTER_CHUNK];
+        const int n = cell.size();
+        // Con coordenadas compactas la consulta se recorta como los
+        // elementos (ver to_coord)
+        pro2::Rect fq = qrect;
+        if constexpr (!std::is_same<Coord, int>::value) {
+            fq = {to_coord(qrect.left), to_coord(qrect.top), to_coord(qrect.right),
+                  to_coord(qrect.bottom)};
+        }
+        FINDER_STAT(query_stats_.cells_visited++; query_stats_.candidates += n);
+        for (int base = 0; base < n; base += pro2::RECT_FILTER_CHUNK) {
+            const int m = pro2::filter_rects(
+                cell.left.data() + base, cell.top.data() + base, cell.right.data() + base,
+                cell.bottom.data() + base, std::min(pro2::RECT_FILTER_CHUNK, n - base), fq,
+                hits);
+            for (int h = 0; h < m; ++h) {
+                const int i = base + hits[h];
+                // Un rectángulo recortado se comprueba con sus coordenadas completas
+                if constexpr (!std::is_same<Coord, int>::value) {
+                    if (cell.saturated(i) && !intersects(entries_[cell.slots[i]].rect, qrect)) {
+                        continue;
+                    }
+                }
+                if (fn(cell.slots[i])) {
+                    return true;
+                }
             }
-            
-            object_rects_.erase(it);
         }
+        return false;
     }
-    
-    // Consultar objetos que intersectan con un rectángulo
-    std::set<const T*> query(pro2::Rect qrect) const {
-        std::set<const T*> result;
-        
-        // Obtener las celdas que el rectángulo de consulta intersecta
-        std::vector<std::pair<int, int>> cells = get_cells(qrect);
-        
-        // Recolectar candidatos de todas las celdas relevantes
-        // Usamos un set para evitar duplicados (un objeto puede estar en múltiples celdas)
-        std::set<const T*> candidates;
-        for (const auto& cell : cells) {
-            const auto& cell_objects = grid_[cell.second][cell.first];
-            candidates.insert(cell_objects.begin(), cell_objects.end());
-        }
-        
-        // Verificar intersección real con cada candidato
-        for (const T* obj : candidates) {
-            if (intersects(obj->get_rect(), qrect)) {
-                result.insert(obj);
+
+    // Nueva marca de consulta. Cuando el contador da la vuelta se limpian
+    // las marcas para que ninguna entrada antigua parezca ya visitada.
+    unsigned next_stamp() const {
+        if (++query_stamp_ == 0) {
+            for (const Entry& e : entries_) {
+                e.stamp = 0;
+            }
+            query_stamp_ = 1;
+        }
+        return query_stamp_;
+    }
+
+    // Llamar a fn(celda) para cada celda existente que intersecta qrect.
+    // Si fn devuelve true el recorrido se detiene y se devuelve true.
+    template <class Fn>
+    bool for_each_cell_in(pro2::Rect qrect, Fn fn) const {
+        const int       min_cx = cell_coord(qrect.left), max_cx = cell_coord(qrect.right);
+        const int       min_cy = cell_coord(qrect.top), max_cy = cell_coord(qrect.bottom);
+        const long long span_x = static_cast<long long>(max_cx) - min_cx + 1;
+        const long long span_y = static_cast<long long>(max_cy) - min_cy + 1;
+
+        if (span_x * span_y > static_cast<long long>(cells_.size())) {
+            // Consulta más grande que la parte ocupada del grid: es más
+            // barato recorrer las celdas existentes que todas las del rango
+            for (const auto& cell : cells_) {
+                int cx = static_cast<int>(static_cast<unsigned int>(cell.first >> 32));
+                int cy = static_cast<int>(static_cast<unsigned int>(cell.first));
+                if (cx >= min_cx && cx <= max_cx && cy >= min_cy && cy <= max_cy) {
+                    if (fn(cell.second)) {
+                        return true;
+                    }
+                }
+            }
+        } else {
+            for (int cy = min_cy; cy <= max_cy; ++cy) {
+                for (int cx = min_cx; cx <= max_cx; ++cx) {
+                    auto it = cells_.find(cell_key(cx, cy));
+                    if (it != cells_.end() && fn(it->second)) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // Llamar a fn(key) una sola vez por cada objeto que intersecta qrect.
+    // Si fn devuelve true el recorrido se detiene y se devuelve true.
+    template <class Fn>
+    bool visit(pro2::Rect qrect, Fn fn) const {
+        FINDER_STAT(query_stats_.queries++; pro2::FinderQueryTimer timer(query_stats_.seconds));
+        const unsigned stamp = next_stamp();
+        return for_each_cell_in(qrect, [&](const Cell& cell) {
+            return filter_cell(cell, qrect, [&](int slot) {
+                const Entry& e = entries_[slot];
+                // Un objeto puede estar en varias celdas: solo se mira una vez
+                if (e.stamp == stamp) {
+                    return false;
+                }
+                e.stamp = stamp;
+                FINDER_STAT(query_stats_.results++);
+                return bool(fn(e.key));
+            });
+        });
+    }
+
+    // Cuadrado de la distancia de p al punto más cercano de r (0 si está dentro)
+    static long long dist2(pro2::Pt p, pro2::Rect r) {
+        const long long dx = p.x < r.left ? r.left - p.x : (p.x > r.right ? p.x - r.right : 0);
+        const long long dy = p.y < r.top ? r.top - p.y : (p.y > r.bottom ? p.y - r.bottom : 0);
+        return dx * dx + dy * dy;
+    }
+
+    static bool closer(const Neighbor& a, const Neighbor& b) {
+        return a.dist2 < b.dist2;
+    }
+
+    // Recorrer los objetos por anillos de celdas alrededor de p: el anillo r
+    // son las celdas a distancia r (en celdas) de la de p. Se llama a
+    // fn(slot) una vez por objeto, y al acabar cada anillo a done(bound2),
+    // donde bound2 es una cota inferior del cuadrado de la distancia de
+    // cualquier objeto aún no visitado (el punto más cercano de un objeto
+    // está en una de sus celdas, así que queda fuera de los anillos ya
+    // recorridos). Si done devuelve true se deja de buscar.
+    template <class Fn, class Done>
+    void visit_rings(pro2::Pt p, Fn fn, Done done) const {
+        const unsigned stamp = next_stamp();
+        size_t         seen = 0;
+        auto           visit_cell = [&](const Cell& cell) {
+            FINDER_STAT(query_stats_.cells_visited++; query_stats_.candidates += cell.size());
+            for (int slot : cell.slots) {
+                const Entry& e = entries_[slot];
+                if (e.stamp != stamp) {
+                    e.stamp = stamp;
+                    seen++;
+                    fn(slot);
+                }
             }
+        };
+        const int px = cell_coord(p.x), py = cell_coord(p.y);
+        for (int r = 0; seen < slots_.size(); ++r) {
+            const long long side = 2LL * r + 1;
+            if (side * side > static_cast<long long>(cells_.size())) {
+                // Los anillos ya cubren más celdas de las que tiene el grid:
+                // es más barato acabar recorriendo las celdas existentes
+                for (const auto& cell : cells_) {
+                    const long long cx = static_cast<int>(static_cast<unsigned int>(cell.first >> 32));
+                    const long long cy = static_cast<int>(static_cast<unsigned int>(cell.first));
+                    if (std::max(std::abs(cx - px), std::abs(cy - py)) >= r) {
+                        visit_cell(cell.second);
+                    }
+                }
+                return;
+            }
+            for (int cy = py - r; cy <= py + r; ++cy) {
+                // En las filas interiores solo las dos celdas de los extremos
+                const int step = (cy == py - r || cy == py + r) ? 1 : std::max(1, 2 * r);
+                for (int cx = px - r; cx <= px + r; cx += step) {
+                    auto it = cells_.find(cell_key(cx, cy));
+                    if (it != cells_.end()) {
+                        visit_cell(it->second);
+                    }
+                }
+            }
+            // Distancia de p al borde del cuadrado de celdas ya recorrido
+            const long long cs = cell_size_;
+            const long long bound =
+                std::min(std::min(p.x - (px - r) * cs + 1, (px + r + 1) * cs - p.x),
+                         std::min(p.y - (py - r) * cs + 1, (py + r + 1) * cs - p.y));
+            if (done(bound * bound)) {
+                return;
+            }
+        }
+    }
+
+public:
+    // Constructor: grid vacío con celdas de `cell_size` píxels de lado (salvo
+    // que Config fije el tamaño), que pide su memoria a `resource` (por
+    // defecto, el heap)
+    explicit Finder(int                         cell_size = DEFAULT_CELL_SIZE,
+                    std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : cell_size_(Config::cell_shift > 0 ? 1 << Config::cell_shift : std::max(1, cell_size)),
+          cells_(resource),
+          entries_(resource),
+          free_slots_(resource),
+          slots_(resource),
+          dirty_(resource) {}
+
+    // Recurso del que el Finder pide su memoria
+    std::pmr::memory_resource* resource() const {
+        return entries_.get_allocator().resource();
+    }
+
+    int cell_size() const {
+        return cell_size_;
+    }
+
+    // Versión del contenido: cambia con cada add/remove y con cada update
+    // que modifica un rectángulo (ver QueryCache)
+    unsigned long long version() const {
+        return version_;
+    }
+
+    const UpdateStats& update_stats() const {
+        return update_stats_;
+    }
+
+    void reset_update_stats() {
+        update_stats_ = UpdateStats();
+    }
+
+    // Ocupación actual de las celdas del grid
+    pro2::FinderOccupancy occupancy() const {
+        pro2::FinderOccupancy occ;
+        for (const auto& cell : cells_) {
+            occ.add_cell(cell.second.size());
+        }
+        return occ;
+    }
+
+#ifdef FINDER_STATS
+    // Contadores de las consultas hechas desde el último reset_query_stats()
+    const pro2::FinderQueryStats& query_stats() const {
+        return query_stats_;
+    }
+
+    void reset_query_stats() {
+        query_stats_ = pro2::FinderQueryStats();
+    }
+
+    // Escribir un resumen de la ocupación y de las consultas
+    void dump_stats(std::ostream& out, const char* name) const {
+        pro2::dump_finder_stats(out, name, cell_size_, occupancy(), query_stats_);
+    }
+#endif
+
+    // Añadir un objeto al finder con el rectángulo `rect`
+    void add(Key key, pro2::Rect rect) {
+        if (slots_.count(key) != 0) {
+            update(key, rect);
+            return;
+        }
+        int slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot = static_cast<int>(entries_.size());
+            entries_.push_back(Entry());
+        }
+        entries_[slot] = {key, rect, cell_range(rect), 0, true, false};
+        version_++;
+        slots_[key] = slot;
+        insert_in_cells(slot, rect, entries_[slot].cells);
+    }
+
+    // Añadir un objeto al finder (claves que son punteros al objeto)
+    void add(Key key) {
+        add(key, key->get_rect());
+    }
+
+    // Actualizar la posición de un objeto.
+    // Solo se insertan o borran elementos de las celdas que el objeto deja o
+    // en las que entra; en las que sigue ocupando solo se reescribe la copia
+    // de su rectángulo.
+    void update(Key key, pro2::Rect rect) {
+        auto it = slots_.find(key);
+        if (it == slots_.end()) {
+            add(key, rect);
+            return;
+        }
+        update_stats_.updates++;
+        Entry& e = entries_[it->second];
+        if (e.rect.left == rect.left && e.rect.top == rect.top && e.rect.right == rect.right &&
+            e.rect.bottom == rect.bottom) {
+            update_stats_.noop_updates++;
+            return;
+        }
+        version_++;
+        e.rect = rect;
+        CellRange old_cells = e.cells;
+        CellRange new_cells = cell_range(rect);
+        if (new_cells == old_cells) {
+            update_stats_.noop_updates++;
+        } else {
+            erase_from_cells(it->second, old_cells, &new_cells);
+        }
+        insert_in_cells(it->second, rect, new_cells, &old_cells);
+        e.cells = new_cells;
+    }
+
+    // Actualizar la posición de un objeto (claves que son punteros al objeto)
+    void update(Key key) {
+        update(key, key->get_rect());
+    }
+
+    // Marcar un objeto cuyo rectángulo puede haber cambiado. No toca el
+    // grid: el objeto se encola (una sola vez) hasta el siguiente sync().
+    void mark_dirty(Key key) {
+        auto it = slots_.find(key);
+        if (it != slots_.end() && !entries_[it->second].dirty) {
+            entries_[it->second].dirty = true;
+            dirty_.push_back(it->second);
+        }
+    }
+
+    // Reconciliar en una sola pasada todos los objetos marcados desde el
+    // último sync(), leyendo su rectángulo actual con rect_of(key).
+    // Los que no han cambiado de celdas no tocan el grid.
+    template <class RectOf>
+    void sync(RectOf rect_of) {
+        for (int slot : dirty_) {
+            Entry& e = entries_[slot];
+            if (e.dirty && e.live) {
+                e.dirty = false;
+                update(e.key, rect_of(e.key));
+            }
+        }
+        dirty_.clear();
+    }
+
+    // sync() para claves que son punteros al objeto
+    void sync() {
+        sync([](Key key) { return key->get_rect(); });
+    }
+
+    // Número de objetos pendientes de sync()
+    int dirty_count() const {
+        return static_cast<int>(dirty_.size());
+    }
+
+    // Remover un objeto del finder
+    void remove(Key key) {
+        auto it = slots_.find(key);
+        if (it != slots_.end()) {
+            Entry& e = entries_[it->second];
+            erase_from_cells(it->second, e.cells);
+            e.live = false;
+            e.dirty = false;
+            version_++;
+            free_slots_.push_back(it->second);
+            slots_.erase(it);
         }
-        
-        return result;
+    }
+
+    // Llamar a fn(Key) para cada objeto que intersecta qrect, sin
+    // construir ningún contenedor. El orden no está especificado.
+    // fn no debe modificar este Finder ni lanzar otra consulta sobre él.
+    template <class Fn>
+    void for_each_in(pro2::Rect qrect, Fn fn) const {
+        visit(qrect, [&](Key key) {
+            fn(key);
+            return false;
+        });
+    }
+
+    // Indica si algún objeto que intersecta qrect cumple pred(Key).
+    // Se detiene en el primer objeto que lo cumple.
+    template <class Pred>
+    bool any_in(pro2::Rect qrect, Pred pred) const {
+        return visit(qrect, [&](Key key) { return bool(pred(key)); });
+    }
+
+    // Consultar objetos que intersectan con un rectángulo, escribiendo el
+    // resultado en un vector del llamador (se vacía primero). Si el vector se
+    // reutiliza entre frames la consulta no hace ninguna reserva de memoria.
+    // El orden del resultado no está especificado.
+    void query(pro2::Rect qrect, std::vector<Key>& result) const {
+        result.clear();
+        for_each_in(qrect, [&](Key key) { result.push_back(key); });
+    }
+
+    // Consultar varios rectángulos a la vez (p.ej. la cámara y sus márgenes)
+    // recorriendo una sola vez las celdas que cubren todos ellos.
+    // results[i] recibe los objetos que intersectan rects[i].
+    void query_many(const std::vector<pro2::Rect>& rects,
+                    std::vector<std::vector<Key>>& results) const {
+        results.resize(rects.size());
+        for (std::vector<Key>& r : results) {
+            r.clear();
+        }
+        if (rects.empty()) {
+            return;
+        }
+        FINDER_STAT(query_stats_.queries++; pro2::FinderQueryTimer timer(query_stats_.seconds));
+        pro2::Rect all = rects[0];
+        for (const pro2::Rect& r : rects) {
+            all.left = std::min(all.left, r.left);
+            all.top = std::min(all.top, r.top);
+            all.right = std::max(all.right, r.right);
+            all.bottom = std::max(all.bottom, r.bottom);
+        }
+        const unsigned stamp = next_stamp();
+        for_each_cell_in(all, [&](const Cell& cell) {
+            return filter_cell(cell, all, [&](int slot) {
+                const Entry& e = entries_[slot];
+                if (e.stamp == stamp) {
+                    return false;
+                }
+                e.stamp = stamp;
+                for (size_t i = 0; i < rects.size(); ++i) {
+                    if (intersects(e.rect, rects[i])) {
+                        FINDER_STAT(query_stats_.results++);
+                        results[i].push_back(e.key);
+                    }
+                }
+                return false;
+            });
+        });
+    }
+
+    // Objetos que toca el rectángulo `moving` al desplazarse `delta`,
+    // ordenados por instante de contacto (0 = posición inicial, 1 = final).
+    // Solo se visitan las celdas por las que pasa el rectángulo.
+    void sweep(pro2::Rect moving, pro2::Pt delta, std::vector<pro2::SweepHit<Key>>& hits) const {
+        FINDER_STAT(query_stats_.queries++; pro2::FinderQueryTimer timer(query_stats_.seconds));
+        hits.clear();
+        const unsigned stamp = next_stamp();
+        auto           coord = [this](int v) { return cell_coord(v); };
+        pro2::for_each_cell_swept(moving, delta, cell_size_, coord, [&](int cx, int cy, pro2::Rect area) {
+            auto it = cells_.find(cell_key(cx, cy));
+            if (it != cells_.end()) {
+                filter_cell(it->second, area, [&](int slot) {
+                    const Entry& e = entries_[slot];
+                    if (e.stamp != stamp) {
+                        e.stamp = stamp;
+                        double t;
+                        if (pro2::sweep_rect(moving, delta, e.rect, t)) {
+                            hits.push_back({e.key, t});
+                        }
+                    }
+                    return false;
+                });
+            }
+            return false;
+        });
+        pro2::sort_hits(hits);
+        FINDER_STAT(query_stats_.results += hits.size());
+    }
+
+    // Objetos que toca el segmento de `from` a `to`, ordenados por distancia
+    // a `from` (t = fracción del segmento recorrida)
+    void raycast(pro2::Pt from, pro2::Pt to, std::vector<pro2::SweepHit<Key>>& hits) const {
+        sweep({from.x, from.y, from.x, from.y}, {to.x - from.x, to.y - from.y}, hits);
+    }
+
+    // Los `k` objetos más cercanos al punto p (distancia euclídea al punto
+    // más cercano de su rectángulo), ordenados de más a menos cercano.
+    // Se recorren anillos de celdas alrededor de p hasta que ningún objeto
+    // no visitado puede estar más cerca que el k-ésimo encontrado.
+    void nearest(pro2::Pt p, int k, std::vector<Neighbor>& result) const {
+        FINDER_STAT(query_stats_.queries++; pro2::FinderQueryTimer timer(query_stats_.seconds));
+        result.clear();
+        if (k <= 0) {
+            return;
+        }
+        // Montículo de máximos con los k mejores candidatos hasta ahora
+        visit_rings(
+            p,
+            [&](int slot) {
+                const Neighbor n = {entries_[slot].key, dist2(p, entries_[slot].rect)};
+                if (static_cast<int>(result.size()) < k) {
+                    result.push_back(n);
+                    std::push_heap(result.begin(), result.end(), closer);
+                } else if (n.dist2 < result.front().dist2) {
+                    std::pop_heap(result.begin(), result.end(), closer);
+                    result.back() = n;
+                    std::push_heap(result.begin(), result.end(), closer);
+                }
+            },
+            [&](long long bound2) {
+                return static_cast<int>(result.size()) == k && result.front().dist2 <= bound2;
+            });
+        std::sort_heap(result.begin(), result.end(), closer);
+        FINDER_STAT(query_stats_.results += result.size());
+    }
+
+    // Objetos a distancia menor o igual que `radius` del punto p, ordenados
+    // de más a menos cercano
+    void within(pro2::Pt p, int radius, std::vector<Neighbor>& result) const {
+        FINDER_STAT(query_stats_.queries++; pro2::FinderQueryTimer timer(query_stats_.seconds));
+        result.clear();
+        if (radius < 0) {
+            return;
+        }
+        const long long r2 = static_cast<long long>(radius) * radius;
+        visit_rings(
+            p,
+            [&](int slot) {
+                const long long d2 = dist2(p, entries_[slot].rect);
+                if (d2 <= r2) {
+                    result.push_back({entries_[slot].key, d2});
+                }
+            },
+            [&](long long bound2) { return bound2 > r2; });
+        std::stable_sort(result.begin(), result.end(), closer);
+        FINDER_STAT(query_stats_.results += result.size());
+    }
+
+    // Consultar objetos que intersectan con un rectángulo
+    std::set<Key> query(pro2::Rect qrect) const {
+        std::vector<Key> found;
+        query(qrect, found);
+        return std::set<Key>(found.begin(), found.end());
     }
 };
 
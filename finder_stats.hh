@@ -0,0 +1,126 @@
+#ifndef FINDER_STATS_HH
+#define FINDER_STATS_HH
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// Instrumentación de los índices espaciales, para ajustar el tamaño de
+// celda con datos de niveles reales. Solo se compila si se pide con
+// -DFINDER_STATS (make STATS=1); si no, desaparece por completo, también
+// en las compilaciones de depuración.
+
+// FINDER_STAT(x) ejecuta x solo si la instrumentación está activada
+#ifdef FINDER_STATS
+#define FINDER_STAT(x) x
+#else
+#define FINDER_STAT(x)
+#endif
+
+namespace pro2 {
+
+/**
+ * @brief Contadores acumulados de las consultas sobre un índice espacial.
+ */
+struct FinderQueryStats {
+    long long queries = 0;        ///< Consultas realizadas
+    long long cells_visited = 0;  ///< Celdas existentes recorridas
+    long long candidates = 0;     ///< Elementos de celda examinados
+    long long results = 0;        ///< Objetos devueltos (sin duplicados)
+    double    seconds = 0.0;      ///< Tiempo total dentro de las consultas
+};
+
+/**
+ * @brief Ocupación de las celdas de un índice espacial en un momento dado.
+ */
+struct FinderOccupancy {
+    int       cells = 0;        ///< Celdas existentes
+    int       empty_cells = 0;  ///< Celdas existentes sin ningún objeto
+    int       max_per_cell = 0;
+    long long entries = 0;  ///< Suma de objetos por celda (un objeto puede estar en varias)
+
+    /**
+     * @brief `histogram[0]` cuenta las celdas vacías y `histogram[i]`, para
+     * i > 0, las celdas con entre 2^(i-1) y 2^i - 1 objetos.
+     */
+    std::vector<int> histogram;
+
+    double mean_per_cell() const {
+        return cells > 0 ? double(entries) / cells : 0.0;
+    }
+
+    /**
+     * @brief Registra una celda con `n` objetos.
+     */
+    void add_cell(int n) {
+        cells++;
+        entries += n;
+        if (n == 0) {
+            empty_cells++;
+        }
+        if (n > max_per_cell) {
+            max_per_cell = n;
+        }
+        size_t bucket = 0;
+        while ((n >> bucket) != 0) {
+            bucket++;
+        }
+        if (histogram.size() <= bucket) {
+            histogram.resize(bucket + 1, 0);
+        }
+        histogram[bucket]++;
+    }
+};
+
+/**
+ * @brief Suma al contador `seconds` el tiempo que vive el objeto.
+ */
+class FinderQueryTimer {
+    double&                               seconds_;
+    std::chrono::steady_clock::time_point start_;
+
+ public:
+    explicit FinderQueryTimer(double& seconds)
+        : seconds_(seconds), start_(std::chrono::steady_clock::now()) {}
+
+    ~FinderQueryTimer() {
+        seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+};
+
+/**
+ * @brief Escribe en `out` un resumen legible de la ocupación y de las consultas.
+ *
+ * @param name Nombre del índice que encabeza el resumen.
+ */
+inline void dump_finder_stats(std::ostream&           out,
+                              const char*             name,
+                              int                     cell_size,
+                              const FinderOccupancy&  occ,
+                              const FinderQueryStats& qs) {
+    out << "--- " << name << " (celdas de " << cell_size << " px) ---" << std::endl;
+    out << "Celdas: " << occ.cells << " (" << occ.empty_cells << " vacías)"
+        << ", objetos por celda: máx " << occ.max_per_cell << ", media " << occ.mean_per_cell()
+        << std::endl;
+    out << "Histograma:";
+    for (size_t i = 0; i < occ.histogram.size(); ++i) {
+        if (i == 0) {
+            out << " [0]=" << occ.histogram[i];
+        } else {
+            out << " [" << (1 << (i - 1)) << "-" << ((1 << i) - 1) << "]=" << occ.histogram[i];
+        }
+    }
+    out << std::endl;
+    if (qs.queries > 0) {
+        out << "Consultas: " << qs.queries << ", por consulta: " << double(qs.cells_visited) / qs.queries
+            << " celdas, " << double(qs.candidates) / qs.queries << " candidatos, "
+            << double(qs.results) / qs.queries << " resultados, "
+            << 1e6 * qs.seconds / qs.queries << " us" << std::endl;
+    } else {
+        out << "Consultas: 0" << std::endl;
+    }
+}
+
+}  // namespace pro2
+
+#endif
@@ -1,8 +1,21 @@
 #include "game.hh"
 using namespace pro2;
 
+// Rectángulo `r` ampliado `margin` píxels por cada lado
+static Rect expanded(Rect r, int margin) {
+    return {r.left - margin, r.top - margin, r.right + margin, r.bottom + margin};
+}
+
 Game::Game(int width, int height)
     : mario_({width / 2, 150}),
+      level_arena_(64 * 1024),
+      level_memory_(&level_arena_),
+      platform_finder_(StaticFinder<Platform>::DEFAULT_CELL_SIZE, &level_memory_),
+      collectible_finder_(CollectibleFinder::DEFAULT_CELL_SIZE, &level_memory_),
+      enemy_finder_(EnemyFinder::DEFAULT_CELL_SIZE, &level_memory_),
+      block_finder_(StaticFinder<SpecialBlock>::DEFAULT_CELL_SIZE, &level_memory_),
+      powerup_finder_(Finder<PowerUp, int>::DEFAULT_CELL_SIZE, &level_memory_),
+      platform_cache_(platform_finder_),
       collected_count_(0),
       lives_(3),
       score_(0),
@@ -20,23 +33,22 @@ Game::Game(int width, int height)
         platforms_.push_back(Platform(x, x + 150, y, y + 11));
     }
     
-    // Añadir todas las plataformas al finder
-    for (const Platform& p : platforms_) {
-        platform_finder_.add(&p);
-    }
+    // Indexar todas las plataformas de una vez
+    platform_finder_.build(platforms_);
     
     // ===== NUEVOS OBJETOS (Part 3) =====
     
-    // Crear ENEMIGOS distribuidos por el nivel (usar std::list)
+    // Crear ENEMIGOS distribuidos por el nivel
+    enemies_.reserve(48);
     for (int i = 2; i < 50; i++) {
         int x = 300 + i * 400;
         int y = 350 + (i % 10) * 50;
-        enemies_.push_back(Enemy({x, y}, Enemy::GOOMBA));
+        enemies_.add({x, y}, EnemyPool::GOOMBA);
     }
     
     // Añadir enemigos al finder
-    for (const Enemy& e : enemies_) {
-        enemy_finder_.add(&e);
+    for (int i = 0; i < enemies_.size(); i++) {
+        enemy_finder_.add(enemies_.handle(i), enemies_.rect(i));
     }
     
     // Crear BLOQUES ESPECIALES con power-ups
@@ -55,10 +67,8 @@ Game::Game(int width, int height)
                                   SpecialBlock::BRICK, false));
     }
     
-    // Añadir bloques al finder
-    for (const SpecialBlock& b : special_blocks_) {
-        block_finder_.add(&b);
-    }
+    // Indexar todos los bloques de una vez
+    block_finder_.build(special_blocks_);
     
     // Crear coleccionables iniciales (menos que antes)
     collectibles_.push_back(Collectible({150, 180}));
@@ -74,8 +84,9 @@ Game::Game(int width, int height)
     }
     
     // Añadir todos los coleccionables al finder
-    for (const Collectible& c : collectibles_) {
-        collectible_finder_.add(&c);
+    // (la clave es la posición en collectibles_, estable aunque el vector crezca)
+    for (int i = 0; i < int(collectibles_.size()); i++) {
+        collectible_finder_.add(i, collectibles_[i].get_rect());
     }
 }
 
@@ -96,47 +107,56 @@ void Game::process_keys(pro2::Window& window) {
 }
 
 void Game::update_objects(pro2::Window& window) {
-    // Obtener el rectángulo visible de la cámara
-    pro2::Rect camera_rect = window.camera_rect();
+    // Expandir un poco el rectángulo de la cámara para incluir objetos justo
+    // fuera de la pantalla. Esto evita pop-in visual y permite colisiones en los bordes
+    pro2::Rect extended_rect = expanded(window.camera_rect(), objects_margin);
     
-    // Expandir un poco el rectángulo para incluir objetos justo fuera de la pantalla
-    // Esto evita pop-in visual y permite colisiones en los bordes
-    const int margin = 200;
-    pro2::Rect extended_rect = {
-        camera_rect.left - margin,
-        camera_rect.top - margin,
-        camera_rect.right + margin,
-        camera_rect.bottom + margin
-    };
-    
-    // Obtener solo las plataformas cercanas usando el Finder
-    std::set<const Platform*> nearby_platforms = platform_finder_.query(extended_rect);
-    
-    // Convertir a vector para pasarlo a Mario::update
-    std::vector<Platform> nearby_platforms_vec;
-    for (const Platform* p : nearby_platforms) {
-        nearby_platforms_vec.push_back(*p);
-    }
-    
-    // Actualizar Mario solo con plataformas cercanas
-    mario_.update(window, nearby_platforms_vec);
+    // Actualizar Mario solo con las plataformas cercanas: se le pasa
+    // directamente el resultado (en caché) de la consulta al Finder
+    mario_.update(window, platform_cache_.query(extended_rect));
     
     // Obtener solo los coleccionables cercanos usando el Finder
-    std::set<const Collectible*> nearby_collectibles = collectible_finder_.query(extended_rect);
-    
-    // Actualizar y verificar colisiones solo con coleccionables cercanos
-    for (const Collectible* c_ptr : nearby_collectibles) {
-        for (Collectible& c : collectibles_) {
-            if (&c == c_ptr) {
-                c.update();
-                if (c.check_collision(mario_.pos())) {
-                    c.collect();
-                    collected_count_++;
-                }
-                break;
-            }
+    collectible_finder_.query(extended_rect, collectible_hits_);
+    
+    // Actualizar y verificar colisiones solo con coleccionables cercanos.
+    // Cada coleccionable solo se toca a sí mismo, así que se reparten
+    // entre los hilos; las recogidas se anotan y se aplican después en
+    // serie y en orden.
+    const int  n = static_cast<int>(collectible_hits_.size());
+    const Pt   mario_pos = mario_.pos();
+    collectible_touched_.resize(n);
+    jobs_.parallel_for(n, collectibles_per_job, [&](int begin, int end, int) {
+        for (int k = begin; k < end; ++k) {
+            Collectible& c = collectibles_[collectible_hits_[k]];
+            c.update();
+            collectible_touched_[k] = c.check_collision(mario_pos);
+        }
+    });
+    // Este bucle es el único sitio donde se mueven los coleccionables (un
+    // Collectible no sabe su índice en collectibles_, que es su clave en el
+    // Finder), así que es aquí donde se marcan
+    for (int k = 0; k < n; ++k) {
+        const int i = collectible_hits_[k];
+        collectible_finder_.mark_dirty(i);
+        if (collectible_touched_[k]) {
+            collectibles_[i].collect();
+            collected_count_++;
         }
     }
+    
+    // Los coleccionables flotan: reubicar en el Finder los que se han movido
+    collectible_finder_.sync([&](int i) { return collectibles_[i].get_rect(); });
+}
+
+void Game::prefetch_platforms(pro2::Window& window) {
+    // Las dos consultas de plataformas de cada frame (el margen de
+    // update_objects y la cámara en paint) se resuelven
+    // con una sola pasada por el grid y quedan en la caché
+    const Rect camera_rect = window.camera_rect();
+    frame_rects_.clear();
+    frame_rects_.push_back(expanded(camera_rect, objects_margin));
+    frame_rects_.push_back(camera_rect);
+    platform_cache_.prefetch(frame_rects_);
 }
 
 void Game::update_camera(pro2::Window& window) {
@@ -166,6 +186,8 @@ void Game::update_camera(pro2::Window& window) {
 void Game::update(pro2::Window& window) {
     process_keys(window);
     if(!pause()){
+        frame_++;
+        prefetch_platforms(window);
         update_objects(window);
         update_enemies(window);
         update_powerups(window);
@@ -182,40 +204,31 @@ void Game::paint(pro2::Window& window) {
     // Obtener el rectángulo visible de la cámara
     pro2::Rect camera_rect = window.camera_rect();
     
-    // Usar el Finder para obtener solo las plataformas visibles
-    std::set<const Platform*> visible_platforms = platform_finder_.query(camera_rect);
-    for (const Platform* p : visible_platforms) {
+    // Usar el Finder para dibujar solo las plataformas visibles
+    // (normalmente ya están en la caché desde update())
+    for (const Platform* p : platform_cache_.query(camera_rect)) {
         p->paint(window);
     }
     
     // Dibujar bloques especiales visibles
-    std::set<const SpecialBlock*> visible_blocks = block_finder_.query(camera_rect);
-    for (const SpecialBlock* b : visible_blocks) {
+    block_finder_.for_each_in(camera_rect, [&](const SpecialBlock* b) {
         b->paint(window);
-    }
+    });
     
-    // Usar el Finder para obtener solo los coleccionables visibles
-    std::set<const Collectible*> visible_collectibles = collectible_finder_.query(camera_rect);
-    for (const Collectible* c : visible_collectibles) {
-        c->paint(window);
-    }
+    // Usar el Finder para dibujar solo los coleccionables visibles
+    collectible_finder_.for_each_in(camera_rect, [&](int i) {
+        collectibles_[i].paint(window);
+    });
     
-    // Dibujar power-ups visibles
-    for (const PowerUp& p : powerups_) {
-        if (!p.is_collected()) {
-            pro2::Rect p_rect = p.get_rect();
-            if (!(p_rect.right < camera_rect.left || p_rect.left > camera_rect.right ||
-                  p_rect.bottom < camera_rect.top || p_rect.top > camera_rect.bottom)) {
-                p.paint(window);
-            }
-        }
-    }
+    // Dibujar power-ups visibles (los recogidos ya no están en el Finder)
+    powerup_finder_.for_each_in(camera_rect, [&](int i) {
+        powerups_[i].paint(window);
+    });
     
     // Dibujar enemigos visibles
-    std::set<const Enemy*> visible_enemies = enemy_finder_.query(camera_rect);
-    for (const Enemy* e : visible_enemies) {
-        e->paint(window);
-    }
+    enemy_finder_.for_each_in(camera_rect, [&](EnemyPool::Handle h) {
+        enemies_.paint(enemies_.index(h), window);
+    });
     
     // Mario siempre se dibuja (siempre está cerca de la cámara)
     mario_.paint(window);
@@ -226,54 +239,88 @@ void Game::paint(pro2::Window& window) {
 // ===== IMPLEMENTACIÓN NUEVOS MÉTODOS (Part 3) =====
 
 void Game::update_enemies(pro2::Window& window) {
-    pro2::Rect camera_rect = window.camera_rect();
-    const int margin = 300;
-    pro2::Rect extended_rect = {
-        camera_rect.left - margin,
-        camera_rect.top - margin,
-        camera_rect.right + margin,
-        camera_rect.bottom + margin
-    };
-    
-    // Obtener plataformas cercanas para los enemigos
-    std::set<const Platform*> nearby_platforms = platform_finder_.query(extended_rect);
-    std::vector<Platform> nearby_platforms_vec;
-    for (const Platform* p : nearby_platforms) {
-        nearby_platforms_vec.push_back(*p);
+    // Solo se simulan los enemigos de la región activa alrededor de la
+    // cámara; el resto duerme. Un enemigo que lleva frames sin simularse se
+    // pone al día al despertar.
+    const pro2::Rect camera = window.camera_rect();
+    const pro2::Rect active = {camera.left - enemies_active_margin, camera.top - enemies_active_margin,
+                               camera.right + enemies_active_margin, camera.bottom + enemies_active_margin};
+    enemy_finder_.query(active, active_handles_);
+    
+    // Recorrer los enemigos en el orden en que están en memoria
+    active_enemies_.clear();
+    for (EnemyPool::Handle h : active_handles_) {
+        active_enemies_.push_back(enemies_.index(h));
     }
+    std::sort(active_enemies_.begin(), active_enemies_.end());
     
-    // Actualizar solo enemigos cercanos y eliminar muertos (std::list permite esto)
-    auto it = enemies_.begin();
-    while (it != enemies_.end()) {
-        if (!it->is_alive()) {
-            // Remover del finder antes de eliminar
-            enemy_finder_.remove(&(*it));
-            it = enemies_.erase(it);  // std::list permite borrado eficiente
-        } else {
-            it->update(nearby_platforms_vec);
-            ++it;
+    for (int i : active_enemies_) {
+        const int slept = frame_ - enemies_.last_frame(i) - 1;
+        if (slept > 0) {
+            wake_enemy(i, slept);
+        }
+        enemies_.set_last_frame(i, frame_);
+    }
+    
+    // Avanzar todos los enemigos activos de una vez, repartidos entre los
+    // hilos: primero las plataformas que puede pisar cada uno (el índice de
+    // plataformas no cambia, así que se puede consultar en paralelo) y
+    // luego la física del lote
+    const int n = static_cast<int>(active_enemies_.size());
+    enemy_step_platforms_.resize(n);
+    jobs_.parallel_for(n, enemies_per_job, [&](int begin, int end, int) {
+        for (int k = begin; k < end; ++k) {
+            platform_finder_.query(enemies_.next_step_bounds(active_enemies_[k]), enemy_step_platforms_[k]);
+        }
+    });
+    enemies_.step(active_enemies_, enemy_step_platforms_, jobs_, enemies_per_job);
+    
+    // Reubicar en el Finder, en una sola pasada, los enemigos que se han
+    // movido (el pool los anota él mismo, también los que ha movido
+    // wake_enemy)
+    enemies_.take_moved([&](EnemyPool::Handle h) { enemy_finder_.mark_dirty(h); });
+    enemy_finder_.sync([&](EnemyPool::Handle h) { return enemies_.rect(enemies_.index(h)); });
+}
+
+void Game::step_enemy(int i) {
+    // Cada enemigo consulta solo las plataformas que puede pisar en este paso
+    platform_finder_.query(enemies_.next_step_bounds(i), enemy_platforms_);
+    enemies_.step(i, enemy_platforms_);
+}
+
+void Game::wake_enemy(int i, int frames) {
+    // Las plataformas no se mueven, así que la patrulla es determinista: en
+    // cuanto el enemigo vuelve al estado en que se durmió se sabe el
+    // periodo y se saltan todas las vueltas completas de golpe
+    const EnemyPool::Motion start = enemies_.motion(i);
+    int done = 0;
+    bool periodic = false;
+    while (done < frames && (periodic || done < max_wake_steps)) {
+        step_enemy(i);
+        done++;
+        if (!periodic && enemies_.motion(i) == start) {
+            periodic = true;
+            const int skipped = (frames - done) / done * done;
+            enemies_.skip_frames(i, skipped);
+            frames -= skipped;
         }
     }
 }
 
 void Game::update_powerups(pro2::Window& window) {
-    // Actualizar power-ups
-    for (PowerUp& p : powerups_) {
-        if (!p.is_collected()) {
-            p.update();
-            
-            // Verificar colisión con Mario
-            if (p.check_collision(mario_.pos())) {
-                p.collect();
-                apply_powerup_effect(p.get_type());
-                score_ += 100;
-            }
-            
-            if (p.check_collision(mario_.pos())) {
-                p.collect();
-                apply_powerup_effect(p.get_type());
-                score_ += 100;
-            }
+    // Actualizar solo los power-ups cercanos, como los coleccionables
+    powerup_finder_.query(expanded(window.camera_rect(), objects_margin), powerup_hits_);
+    std::sort(powerup_hits_.begin(), powerup_hits_.end());
+    for (int i : powerup_hits_) {
+        PowerUp& p = powerups_[i];
+        p.update();
+        
+        // Verificar colisión con Mario
+        if (p.check_collision(mario_.pos())) {
+            p.collect();
+            powerup_finder_.remove(i);
+            apply_powerup_effect(p.get_type());
+            score_ += 100;
         }
     }
 }
@@ -282,14 +329,43 @@ void Game::update_special_blocks(pro2::Window& window) {
     pro2::Pt mario_pos = mario_.pos();
     static pro2::Pt mario_last_pos = mario_pos;
     
-    for (SpecialBlock& block : special_blocks_) {
-        block.update();
-        
+    // Solo los bloques que están rebotando necesitan update()
+    size_t kept = 0;
+    for (int i : bouncing_blocks_) {
+        special_blocks_[i].update();
+        if (special_blocks_[i].is_bouncing()) {
+            bouncing_blocks_[kept++] = i;
+        }
+    }
+    bouncing_blocks_.resize(kept);
+    
+    // Mario solo golpea un bloque desde abajo si sube: los candidatos son
+    // los bloques que toca la línea horizontal de check_hit_from_below
+    // (Mario ± hit_margin) al desplazarse desde la posición anterior
+    block_hits_.clear();
+    if (mario_pos.y < mario_last_pos.y) {
+        const int  m = SpecialBlock::hit_margin;
+        const Rect line = {mario_last_pos.x - m, mario_last_pos.y, mario_last_pos.x + m, mario_last_pos.y};
+        const Pt   delta = {mario_pos.x - mario_last_pos.x, mario_pos.y - mario_last_pos.y};
+        block_finder_.for_each_in(pro2::swept_bounds(line, delta), [&](const SpecialBlock* b) {
+            block_hits_.push_back(static_cast<int>(b - special_blocks_.data()));
+        });
+        std::sort(block_hits_.begin(), block_hits_.end());
+    }
+    
+    for (int i : block_hits_) {
+        SpecialBlock& block = special_blocks_[i];
+        const bool    was_bouncing = block.is_bouncing();
         if (block.check_hit_from_below(mario_pos, mario_last_pos)) {
+            if (!was_bouncing) {
+                bouncing_blocks_.push_back(i);
+            }
             PowerUp* new_powerup = block.activate();
             if (new_powerup != nullptr) {
                 powerups_.push_back(*new_powerup);
                 delete new_powerup;
+                const int p = static_cast<int>(powerups_.size()) - 1;
+                powerup_finder_.add(p, powerups_[p].get_rect());
                 score_ += 50;
             }
         }
@@ -299,39 +375,29 @@ void Game::update_special_blocks(pro2::Window& window) {
 }
 
 void Game::update_effects() {
-    // Actualizar efectos activos usando la queue
-    std::queue<TimedEffect> updated_effects;
-    
-    while (!active_effects_.empty()) {
-        TimedEffect effect = active_effects_.front();
-        active_effects_.pop();
-        
-        effect.frames_remaining--;
-        
-        if (effect.frames_remaining > 0) {
-            updated_effects.push(effect);
-            active_effect_timers_[effect.type] = effect.frames_remaining;
-        } else {
-            // Efecto terminado, remover del map
-            active_effect_timers_.erase(effect.type);
+    // Los efectos no cuestan nada hasta el frame en que acaban. Si un
+    // efecto se ha alargado (otro power-up del mismo tipo) su fin antiguo
+    // ya no es vigente y se ignora.
+    effect_timers_.run_due(frame_, [&](PowerUp::Type type, int deadline) {
+        if (effect_end_[type] == deadline) {
+            active_effects_ &= ~(1u << type);
         }
-    }
-    
-    active_effects_ = updated_effects;
+    });
 }
 
 void Game::check_enemy_collisions() {
-    // Verificar colisiones de Mario con enemigos
-    for (Enemy& enemy : enemies_) {
-        if (!enemy.is_alive()) continue;
-        
+    // Verificar colisiones de Mario con los enemigos que lo tocan
+    enemy_finder_.query(EnemyPool::mario_hit_rect(mario_.pos()), active_handles_);
+    for (EnemyPool::Handle h : active_handles_) {
         bool jumped_on = false;
         
         // Verificar con mario_
-        if (enemy.check_collision_with_mario(mario_.pos(), jumped_on)) {
+        if (enemies_.check_collision_with_mario(enemies_.index(h), mario_.pos(), jumped_on)) {
             if (jumped_on || has_active_effect(PowerUp::STAR)) {
                 // Mario salta sobre el enemigo o es invencible -> matar enemigo
-                enemy.kill();
+                // (los Handles de los demás siguen siendo válidos)
+                enemy_finder_.remove(h);
+                enemies_.remove(h);
                 score_ += 200;
                 // Aquí se podría añadir un rebote pequeño a Mario
             } else {
@@ -351,14 +417,20 @@ void Game::apply_powerup_effect(PowerUp::Type type) {
     PowerUp temp_powerup({0, 0}, type);
     PowerUp::Config cfg = temp_powerup.get_config();
     
-    // Añadir efecto a la queue
-    active_effects_.push(TimedEffect(type, cfg.duration_frames));
-    active_effect_timers_[type] = cfg.duration_frames;
+    // El efecto se nota hasta el update_effects de su último frame
+    // (duration_frames frames contando este). Si ya estaba activo, dura
+    // hasta el más tardío de los dos finales.
+    const int end = frame_ + cfg.duration_frames - 1;
+    if (!has_active_effect(type) || end > effect_end_[type]) {
+        effect_end_[type] = end;
+        effect_timers_.schedule(end, type);
+    }
+    active_effects_ |= 1u << type;
     
     std::cout << "Power-up activado: " << cfg.name 
               << " (duración: " << cfg.duration_frames << " frames)" << std::endl;
 }
 
 bool Game::has_active_effect(PowerUp::Type type) const {
-    return active_effect_timers_.find(type) != active_effect_timers_.end();
+    return (active_effects_ >> type) & 1u;
 }
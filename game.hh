@@ -2,10 +2,9 @@
 #define GAME_HH
 
 #include <vector>
-#include <list>
-#include <queue>
-#include <map>
+#include <algorithm>
 #include <iostream>
+#include <memory_resource>
 #include "Mario.hh"
 #include "platform.hh"
 #include "collectible.hh"
@@ -13,29 +12,85 @@
 #include "powerup.hh"
 #include "specialblock.hh"
 #include "finder.hh"
+#include "static_finder.hh"
+#include "query_cache.hh"
+#include "job_system.hh"
+#include "timer_scheduler.hh"
 #include "window.hh"
 
 class Game {
+    // Índices adaptados a cada tipo de objeto (ver FinderConfig): celdas de
+    // 1024 px en ambos; hay pocos coleccionables por celda, así que las
+    // celdas no reservan memoria aparte. Las coordenadas son int: el nivel
+    // pasa de x = 32767 y con 16 bits buena parte de los coleccionables
+    // quedarían recortados (ver FinderConfig)
+    using CollectibleFinder = Finder<Collectible, int, FinderConfig<10, int, 8>>;
+    using EnemyFinder = Finder<EnemyPool, EnemyPool::Handle, FinderConfig<10, int, 4>>;
+
     Mario                      mario_;
     std::vector<Platform>      platforms_;
     std::vector<Collectible>   collectibles_;
     
     // NUEVOS OBJETOS (Part 3)
-    std::list<Enemy>           enemies_;           // std::list para gestión dinámica
+    EnemyPool                  enemies_;           // Structure-of-arrays, ver EnemyPool
     std::vector<PowerUp>       powerups_;
     std::vector<SpecialBlock>  special_blocks_;
     
-    // CONTENEDOR STL: Queue para efectos temporales activos
-    std::queue<TimedEffect>    active_effects_;
+    // Efectos de power-up activos: un bit por tipo, el frame en que acaba
+    // cada uno y el fin de cada efecto programado (ver update_effects)
+    static constexpr int effect_types = PowerUp::FEATHER + 1;
+    
+    unsigned                       active_effects_ = 0;
+    int                            effect_end_[effect_types] = {};
+    TimerScheduler<PowerUp::Type>  effect_timers_;
+    
+    // Hilos para repartir la actualización de muchos objetos
+    JobSystem                  jobs_;
+    
+    // Memoria de los índices espaciales del nivel: un pool (que reutiliza
+    // los bloques liberados) sobre un arena monotónico. Al descargar el
+    // nivel el arena devuelve toda la memoria de una vez. Tienen que
+    // declararse antes que los finders que los usan.
+    std::pmr::monotonic_buffer_resource    level_arena_;
+    std::pmr::unsynchronized_pool_resource level_memory_;
+    
+    // Finders para optimizar consultas espaciales. Las plataformas y los
+    // bloques no se mueven: usan un índice estático construido de una vez
+    StaticFinder<Platform>     platform_finder_;
+    CollectibleFinder          collectible_finder_;  // Claves: índices en collectibles_
+    EnemyFinder                enemy_finder_;        // Claves: Handles de enemies_
+    StaticFinder<SpecialBlock> block_finder_;
+    Finder<PowerUp, int>       powerup_finder_;      // Claves: índices en powerups_ (sin recoger)
+    
+    // Caché de las consultas de plataformas del frame y rectángulos que
+    // se cargan en ella al principio de cada update()
+    QueryCache<StaticFinder<Platform>> platform_cache_;
+    std::vector<pro2::Rect>            frame_rects_;
+    
+    // Buffer reutilizado por las consultas de coleccionables: así la
+    // consulta de cada frame no reserva memoria
+    std::vector<int> collectible_hits_;
     
-    // CONTENEDOR STL: Map para tracking de efectos activos por tipo
-    std::map<PowerUp::Type, int> active_effect_timers_;
+    // Power-ups cercanos a Mario en este frame
+    std::vector<int> powerup_hits_;
     
-    // Finders para optimizar consultas espaciales
-    Finder<Platform>           platform_finder_;
-    Finder<Collectible>        collectible_finder_;
-    Finder<Enemy>              enemy_finder_;
-    Finder<SpecialBlock>       block_finder_;
+    // Bloques que Mario puede haber golpeado en este frame y bloques que
+    // están haciendo la animación de rebote (índices en special_blocks_)
+    std::vector<int> block_hits_;
+    std::vector<int> bouncing_blocks_;
+    
+    // Coleccionables de collectible_hits_ que Mario toca en este frame
+    std::vector<char> collectible_touched_;
+    
+    // Buffers de update_enemies: enemigos de la región activa (o que tocan
+    // a Mario), sus índices en enemies_ y las plataformas que puede pisar
+    // cada uno
+    std::vector<EnemyPool::Handle>             active_handles_;
+    std::vector<int>                           active_enemies_;
+    std::vector<std::vector<const Platform*>>  enemy_step_platforms_;
+    std::vector<const Platform*>               enemy_platforms_;
+    
+    int frame_ = 0;  // Frames simulados (sin contar las pausas)
     
     int collected_count_;  // Contador de objetos recogidos
     int lives_;            // Vidas del jugador
@@ -48,9 +103,12 @@ class Game {
     void process_keys(pro2::Window& window);
     void update_objects(pro2::Window& window);
     void update_camera(pro2::Window& window);
+    void prefetch_platforms(pro2::Window& window);
     
     // NUEVOS MÉTODOS (Part 3)
     void update_enemies(pro2::Window& window);
+    void step_enemy(int i);
+    void wake_enemy(int i, int frames);
     void update_powerups(pro2::Window& window);
     void update_special_blocks(pro2::Window& window);
     void update_effects();
@@ -104,11 +162,31 @@ class Game {
                   << (100.0 * (visible_platforms.size() + visible_collectibles.size()) / 
                      (platforms_.size() + collectibles_.size()))
                   << "%" << std::endl;
+#ifdef FINDER_STATS
+        collectible_finder_.dump_stats(std::cout, "Coleccionables");
+        enemy_finder_.dump_stats(std::cout, "Enemigos");
+#endif
         std::cout << "===============================" << std::endl;
     }
 
  private:
     static constexpr int sky_blue = 0x5c94fc;
+    
+    // Margen alrededor de la cámara para actualizar objetos
+    static constexpr int objects_margin = 200;
+    
+    // Margen alrededor de la cámara de la región activa: los enemigos fuera
+    // de ella duermen y no cuestan nada por frame
+    static constexpr int enemies_active_margin = 400;
+    
+    // Pasos como máximo que se simulan al despertar un enemigo cuya
+    // patrulla no se repite (p.ej. uno que cae al vacío)
+    static constexpr int max_wake_steps = 1000;
+    
+    // Objetos por trozo al repartir su actualización entre hilos: con
+    // menos de un trozo no se usan hilos
+    static constexpr int enemies_per_job = 512;
+    static constexpr int collectibles_per_job = 1024;
 };
 
 #endif
\ No newline at end of file
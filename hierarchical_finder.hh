@@ -0,0 +1,244 @@
+#ifndef HIERARCHICAL_FINDER_HH
+#define HIERARCHICAL_FINDER_HH
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <memory_resource>
+#include <algorithm>
+#include "geometry.hh"
+#include "finder.hh"
+
+// Índice espacial con varios grids de distinto tamaño de celda, para
+// mezclar objetos muy pequeños (monedas de 8 px) con objetos muy grandes
+// (suelos de miles de píxels).
+//
+// El nivel i usa celdas de base·4^i píxels, y cada objeto se guarda en el
+// primer nivel cuyas celdas son al menos tan grandes como el objeto: así
+// ningún objeto ocupa más de 2x2 celdas de su nivel y los objetos pequeños
+// no comparten celda con cientos de vecinos. Una consulta mira todos los
+// niveles que tienen algún objeto; cada objeto está en un solo nivel, así
+// que no hay duplicados entre niveles.
+//
+// Tiene la misma interfaz que Finder (add, update, mark_dirty/sync, remove,
+// for_each_in, any_in, query, query_many), así que puede sustituirlo
+// directamente, también como índice de una QueryCache. Todos los niveles
+// piden su memoria al memory_resource que se pasa al constructor.
+template <class T, class Key = const T*>
+class HierarchicalFinder {
+public:
+    using key_type = Key;
+
+    static constexpr int DEFAULT_BASE_CELL_SIZE = 64;
+    static constexpr int DEFAULT_LEVELS = 5;  // 64, 256, 1024, 4096 y 16384 px
+
+private:
+    struct Info {
+        int  level;
+        bool dirty;  // Ya está en la cola dirty_
+    };
+
+    std::vector<Finder<T, Key>> levels_;
+    std::vector<int>            counts_;  // Objetos en cada nivel
+
+    std::pmr::unordered_map<Key, Info> info_;
+
+    // Objetos marcados con mark_dirty() pendientes de sync()
+    std::pmr::vector<Key> dirty_;
+
+    // Se incrementa cada vez que un objeto cambia de nivel
+    unsigned long long moves_ = 0;
+
+    // Buffer para query_many(), reutilizado entre llamadas
+    mutable std::vector<std::vector<Key>> level_results_;
+
+    // Nivel que corresponde a un rectángulo según su lado mayor
+    int level_of(pro2::Rect rect) const {
+        const long long size =
+            std::max(static_cast<long long>(rect.right) - rect.left,
+                     static_cast<long long>(rect.bottom) - rect.top) + 1;
+        int level = 0;
+        while (level + 1 < levels() && size > levels_[level].cell_size()) {
+            level++;
+        }
+        return level;
+    }
+
+public:
+    // Constructor: `levels` grids con celdas de base_cell_size, 4 veces
+    // más grandes, 16 veces más grandes...
+    explicit HierarchicalFinder(int                         base_cell_size = DEFAULT_BASE_CELL_SIZE,
+                                int                         levels = DEFAULT_LEVELS,
+                                std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : info_(resource), dirty_(resource) {
+        long long cell_size = std::max(1, base_cell_size);
+        for (int i = 0; i < std::max(1, levels); ++i) {
+            levels_.emplace_back(static_cast<int>(std::min<long long>(cell_size, 1 << 30)), resource);
+            counts_.push_back(0);
+            cell_size *= 4;
+        }
+    }
+
+    int levels() const {
+        return static_cast<int>(levels_.size());
+    }
+
+    // Grid de un nivel (p.ej. para consultar sus UpdateStats)
+    const Finder<T, Key>& level(int i) const {
+        return levels_[i];
+    }
+
+    // Número de objetos en el nivel i
+    int level_count(int i) const {
+        return counts_[i];
+    }
+
+    // Versión del contenido (ver Finder::version y QueryCache)
+    unsigned long long version() const {
+        unsigned long long v = moves_;
+        for (const Finder<T, Key>& f : levels_) {
+            v += f.version();
+        }
+        return v;
+    }
+
+    // Añadir un objeto con el rectángulo `rect`
+    void add(Key key, pro2::Rect rect) {
+        if (info_.count(key) != 0) {
+            update(key, rect);
+            return;
+        }
+        const int level = level_of(rect);
+        info_[key] = {level, false};
+        counts_[level]++;
+        levels_[level].add(key, rect);
+    }
+
+    // Añadir un objeto (claves que son punteros al objeto)
+    void add(Key key) {
+        add(key, key->get_rect());
+    }
+
+    // Actualizar la posición de un objeto. Si su tamaño ya no corresponde
+    // a su nivel se pasa al nivel adecuado.
+    void update(Key key, pro2::Rect rect) {
+        auto it = info_.find(key);
+        if (it == info_.end()) {
+            add(key, rect);
+            return;
+        }
+        const int level = level_of(rect);
+        if (level == it->second.level) {
+            levels_[level].update(key, rect);
+            return;
+        }
+        levels_[it->second.level].remove(key);
+        counts_[it->second.level]--;
+        levels_[level].add(key, rect);
+        counts_[level]++;
+        it->second.level = level;
+        moves_++;
+    }
+
+    // Actualizar la posición de un objeto (claves que son punteros al objeto)
+    void update(Key key) {
+        update(key, key->get_rect());
+    }
+
+    // Marcar un objeto cuyo rectángulo puede haber cambiado (ver Finder::mark_dirty)
+    void mark_dirty(Key key) {
+        auto it = info_.find(key);
+        if (it != info_.end() && !it->second.dirty) {
+            it->second.dirty = true;
+            dirty_.push_back(key);
+        }
+    }
+
+    // Reconciliar los objetos marcados, leyendo su rectángulo con rect_of(key)
+    template <class RectOf>
+    void sync(RectOf rect_of) {
+        for (Key key : dirty_) {
+            auto it = info_.find(key);
+            if (it != info_.end() && it->second.dirty) {
+                it->second.dirty = false;
+                update(key, rect_of(key));
+            }
+        }
+        dirty_.clear();
+    }
+
+    // sync() para claves que son punteros al objeto
+    void sync() {
+        sync([](Key key) { return key->get_rect(); });
+    }
+
+    int dirty_count() const {
+        return static_cast<int>(dirty_.size());
+    }
+
+    // Remover un objeto
+    void remove(Key key) {
+        auto it = info_.find(key);
+        if (it != info_.end()) {
+            levels_[it->second.level].remove(key);
+            counts_[it->second.level]--;
+            info_.erase(it);
+        }
+    }
+
+    // Llamar a fn(Key) para cada objeto que intersecta qrect (ver Finder::for_each_in)
+    template <class Fn>
+    void for_each_in(pro2::Rect qrect, Fn fn) const {
+        for (int i = 0; i < levels(); ++i) {
+            if (counts_[i] > 0) {
+                levels_[i].for_each_in(qrect, fn);
+            }
+        }
+    }
+
+    // Indica si algún objeto que intersecta qrect cumple pred(Key)
+    template <class Pred>
+    bool any_in(pro2::Rect qrect, Pred pred) const {
+        for (int i = 0; i < levels(); ++i) {
+            if (counts_[i] > 0 && levels_[i].any_in(qrect, pred)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Consultar objetos que intersectan con un rectángulo, escribiendo el
+    // resultado en un vector del llamador (se vacía primero)
+    void query(pro2::Rect qrect, std::vector<Key>& result) const {
+        result.clear();
+        for_each_in(qrect, [&](Key key) { result.push_back(key); });
+    }
+
+    // Consultar varios rectángulos a la vez (ver Finder::query_many)
+    void query_many(const std::vector<pro2::Rect>& rects,
+                    std::vector<std::vector<Key>>& results) const {
+        results.resize(rects.size());
+        for (std::vector<Key>& r : results) {
+            r.clear();
+        }
+        for (int i = 0; i < levels(); ++i) {
+            if (counts_[i] == 0) {
+                continue;
+            }
+            levels_[i].query_many(rects, level_results_);
+            for (size_t j = 0; j < rects.size(); ++j) {
+                results[j].insert(results[j].end(), level_results_[j].begin(),
+                                  level_results_[j].end());
+            }
+        }
+    }
+
+    // Consultar objetos que intersectan con un rectángulo
+    std::set<Key> query(pro2::Rect qrect) const {
+        std::vector<Key> found;
+        query(qrect, found);
+        return std::set<Key>(found.begin(), found.end());
+    }
+};
+
+#endif
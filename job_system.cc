@@ -0,0 +1,91 @@
+#include "job_system.hh"
+#include <algorithm>
+
+JobSystem::JobSystem(int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    threads = std::max(1, threads);
+    for (int i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 1; i < threads; ++i) {
+        workers_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t : workers_) {
+        t.join();
+    }
+}
+
+void JobSystem::run_chunks(int n, int grain, ChunkFn fn, void* ctx) {
+    grain = std::max(1, grain);
+    const int        chunks = (n + grain - 1) / grain;
+    std::atomic<int> pending{chunks};
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        queued_ += chunks;
+    }
+    // Repartir los trozos por turnos entre todas las colas
+    for (int c = 0; c < chunks; ++c) {
+        Queue&                      q = *queues_[c % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.jobs.push_back({fn, ctx, c * grain, std::min(n, (c + 1) * grain), &pending});
+    }
+    wake_.notify_all();
+
+    // Trabajar también mientras se espera al resto
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!run_one(0)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::run_one(int self) {
+    Job        job;
+    bool       found = false;
+    const int  count = static_cast<int>(queues_.size());
+    for (int k = 0; k < count && !found; ++k) {
+        Queue&                      q = *queues_[(self + k) % count];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.jobs.empty()) {
+            // La cola propia por el final, las ajenas por el principio
+            if (k == 0) {
+                job = q.jobs.back();
+                q.jobs.pop_back();
+            } else {
+                job = q.jobs.front();
+                q.jobs.pop_front();
+            }
+            queued_--;
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    job.fn(job.ctx, job.begin, job.end, self);
+    job.pending->fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::worker_loop(int self) {
+    for (;;) {
+        if (run_one(self)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef JOB_SYSTEM_HH
+#define JOB_SYSTEM_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reparto de trabajo entre todos los núcleos con robo de tareas.
+//
+// parallel_for() trocea un rango de índices y reparte los trozos entre las
+// colas de todos los hilos (los workers y el hilo que llama, que también
+// trabaja mientras espera). Cada hilo saca trozos del final de su cola y,
+// cuando se queda sin trabajo, roba del principio de la cola de otro: así
+// un hilo que ha tenido trozos más caros no retrasa a los demás.
+//
+// Los trozos se ejecutan en cualquier orden y en cualquier hilo, así que
+// cada uno solo debe escribir en sus propias posiciones. Los efectos que
+// cambian el estado de la partida (muertes, recogidas, puntuación) se
+// guardan por índice y se aplican después en serie y en orden, de forma
+// que el resultado no depende del número de hilos.
+class JobSystem {
+public:
+    // Constructor: `threads` hilos en total contando el que llama a
+    // parallel_for (0 = uno por núcleo)
+    explicit JobSystem(int threads = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Número de hilos que ejecutan trozos (workers + el que llama)
+    int threads() const {
+        return static_cast<int>(workers_.size()) + 1;
+    }
+
+    // Llamar a fn(begin, end, worker) para trozos consecutivos de como
+    // mucho `grain` índices que cubren [0, n), y esperar a que acaben.
+    // `worker` (0..threads()-1) identifica el hilo, p.ej. para usar buffers
+    // propios. Si todo cabe en un trozo se ejecuta directamente. No se
+    // puede llamar desde dentro de un trozo.
+    template <class Fn>
+    void parallel_for(int n, int grain, Fn fn) {
+        if (n <= 0) {
+            return;
+        }
+        if (threads() == 1 || n <= grain) {
+            fn(0, n, 0);
+            return;
+        }
+        run_chunks(n, grain, &JobSystem::call<Fn>, &fn);
+    }
+
+private:
+    using ChunkFn = void (*)(void*, int, int, int);
+
+    struct Job {
+        ChunkFn           fn;
+        void*             ctx;
+        int               begin, end;
+        std::atomic<int>* pending;  // Trozos de su parallel_for que faltan
+    };
+
+    // Cada cola en su propia línea de caché
+    struct alignas(64) Queue {
+        std::mutex      mutex;
+        std::deque<Job> jobs;
+    };
+
+    template <class Fn>
+    static void call(void* ctx, int begin, int end, int worker) {
+        (*static_cast<Fn*>(ctx))(begin, end, worker);
+    }
+
+    // La cola 0 es la del hilo que llama a parallel_for, la i la del worker i
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread>            workers_;
+
+    // Los workers duermen aquí cuando no hay trozos en ninguna cola
+    std::mutex              sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<int>        queued_{0};
+    bool                    stop_ = false;
+
+    void run_chunks(int n, int grain, ChunkFn fn, void* ctx);
+
+    // Ejecutar un trozo de la cola propia o robado de otra. Devuelve false
+    // si no había ninguno.
+    bool run_one(int self);
+
+    void worker_loop(int self);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "mapped_file.hh"
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pro2 {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+#ifdef MAPPED_FILE_MMAP
+    if (mapped_) {
+        munmap(const_cast<void*>(data_), size_);
+    }
+#endif
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+bool MappedFile::open(const char* path) {
+    close();
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        data_ = p;
+        mapped_ = true;
+    }
+    // La proyección sigue siendo válida después de cerrar el descriptor
+    ::close(fd);
+    return true;
+#else
+    FILE* f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    std::fseek(f, 0, SEEK_END);
+    long n = std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+    if (n < 0) {
+        std::fclose(f);
+        return false;
+    }
+    size_ = static_cast<size_t>(n);
+    buffer_.resize((size_ + sizeof(long long) - 1) / sizeof(long long));
+    bool ok = std::fread(buffer_.data(), 1, size_, f) == size_;
+    std::fclose(f);
+    if (!ok) {
+        close();
+        return false;
+    }
+    data_ = buffer_.data();
+    return true;
+#endif
+}
+
+bool write_file(const char* path, const void* data, size_t size) {
+    FILE* f = std::fopen(path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, size, f) == size;
+    return std::fclose(f) == 0 && ok;
+}
+
+}  // namespace pro2
@@ -0,0 +1,59 @@
+#ifndef MAPPED_FILE_HH
+#define MAPPED_FILE_HH
+
+#include <cstddef>
+#include <vector>
+
+namespace pro2 {
+
+/**
+ * @brief Fichero de solo lectura proyectado en memoria (mmap).
+ *
+ * El contenido se lee del disco a medida que se accede a él, así que abrir
+ * un fichero grande es inmediato. En sistemas sin mmap se lee entero.
+ * Los datos quedan alineados al menos a 8 bytes.
+ */
+class MappedFile {
+    const void*            data_ = nullptr;
+    size_t                 size_ = 0;
+    bool                   mapped_ = false;
+    std::vector<long long> buffer_;  // Copia del fichero si no se puede proyectar
+
+ public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Abre el fichero `path` (cerrando el anterior, si lo había).
+     *
+     * @return false si el fichero no existe o no se puede leer.
+     */
+    bool open(const char* path);
+
+    /**
+     * @brief Cierra el fichero. Los punteros obtenidos con `data()` dejan de ser válidos.
+     */
+    void close();
+
+    const void* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+};
+
+/**
+ * @brief Escribe `size` bytes de `data` en el fichero `path` (sustituyéndolo).
+ *
+ * @return false si no se ha podido escribir entero.
+ */
+bool write_file(const char* path, const void* data, size_t size);
+
+}  // namespace pro2
+
+#endif
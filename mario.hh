@@ -48,7 +48,9 @@ class Mario {
 
     void jump();
 
-    void update(pro2::Window& window, const std::vector<Platform>& platforms);
+    // `platforms` son las plataformas cercanas (p.ej. el resultado de una
+    // consulta al Finder), sin copiarlas
+    void update(pro2::Window& window, const std::vector<const Platform*>& platforms);
 
  private:
     static const std::vector<std::vector<int>> mario_sprite_normal_;
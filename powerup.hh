@@ -49,13 +49,4 @@ public:
     }
 };
 
-// Estructura para efectos temporales activos
-struct TimedEffect {
-    PowerUp::Type type;
-    int frames_remaining;
-    
-    TimedEffect(PowerUp::Type t, int frames) 
-        : type(t), frames_remaining(frames) {}
-};
-
 #endif
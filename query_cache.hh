@@ -0,0 +1,124 @@
+#ifndef QUERY_CACHE_HH
+#define QUERY_CACHE_HH
+
+#include <vector>
+#include "geometry.hh"
+
+// Caché de consultas por rectángulo sobre un índice espacial (Finder o
+// StaticFinder). Dentro de un frame se consulta varias veces el mismo
+// rectángulo (la cámara en update y en paint, la cámara con sus márgenes...);
+// la caché guarda los últimos resultados y los devuelve sin volver a recorrer
+// el grid mientras el rectángulo sea el mismo y el índice no haya cambiado
+// (se compara con Index::version()).
+//
+// El índice tiene que vivir más que la caché.
+template <class Index>
+class QueryCache {
+public:
+    using Key = typename Index::key_type;
+
+private:
+    struct Slot {
+        pro2::Rect         rect;
+        unsigned long long version;
+        bool               valid = false;
+        std::vector<Key>   result;
+    };
+
+    const Index&      index_;
+    std::vector<Slot> slots_;
+    int               next_ = 0;  // Próxima entrada a reemplazar (round robin)
+
+    // Buffers para prefetch(), reutilizados entre frames
+    std::vector<pro2::Rect>       missing_;
+    std::vector<std::vector<Key>> missing_results_;
+
+    static bool same_rect(pro2::Rect a, pro2::Rect b) {
+        return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+    }
+
+    static bool contains(const std::vector<pro2::Rect>& rects, pro2::Rect rect) {
+        for (const pro2::Rect& r : rects) {
+            if (same_rect(r, rect)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Slot* find(pro2::Rect rect) {
+        for (Slot& s : slots_) {
+            if (s.valid && s.version == index_.version() && same_rect(s.rect, rect)) {
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+
+    // Entrada a reemplazar, saltándose las que guardan alguno de los
+    // rectángulos de `keep` (si es posible)
+    Slot& victim(const std::vector<pro2::Rect>* keep = nullptr) {
+        for (size_t tries = 0; tries < slots_.size(); ++tries) {
+            Slot& s = slots_[next_];
+            next_ = (next_ + 1) % int(slots_.size());
+            if (keep == nullptr || !s.valid || s.version != index_.version() ||
+                !contains(*keep, s.rect)) {
+                return s;
+            }
+        }
+        Slot& s = slots_[next_];
+        next_ = (next_ + 1) % int(slots_.size());
+        return s;
+    }
+
+public:
+    explicit QueryCache(const Index& index, int capacity = 4)
+        : index_(index), slots_(capacity > 0 ? capacity : 1) {}
+
+    // Resultado de index.query(rect). La referencia es válida hasta la
+    // siguiente llamada a query(), prefetch() o clear().
+    const std::vector<Key>& query(pro2::Rect rect) {
+        Slot* hit = find(rect);
+        if (hit != nullptr) {
+            return hit->result;
+        }
+        Slot& s = victim();
+        index_.query(rect, s.result);
+        s.rect = rect;
+        s.version = index_.version();
+        s.valid = true;
+        return s.result;
+    }
+
+    // Cargar en la caché varios rectángulos que se van a consultar en este
+    // frame, con una sola pasada por el grid (Index::query_many). No debe
+    // pedir más rectángulos que la capacidad de la caché.
+    void prefetch(const std::vector<pro2::Rect>& rects) {
+        missing_.clear();
+        for (const pro2::Rect& r : rects) {
+            if (find(r) == nullptr) {
+                missing_.push_back(r);
+            }
+        }
+        if (missing_.empty()) {
+            return;
+        }
+        index_.query_many(missing_, missing_results_);
+        for (size_t i = 0; i < missing_.size(); ++i) {
+            Slot& s = victim(&rects);
+            s.result.swap(missing_results_[i]);
+            s.rect = missing_[i];
+            s.version = index_.version();
+            s.valid = true;
+        }
+    }
+
+    // Olvidar todos los resultados guardados
+    void clear() {
+        for (Slot& s : slots_) {
+            s.valid = false;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include "rect_filter.hh"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RECT_FILTER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace pro2 {
+
+// Versión de referencia: un rectángulo cada vez
+template <class Coord>
+static int filter_rects_scalar(const Coord* left,
+                               const Coord* top,
+                               const Coord* right,
+                               const Coord* bottom,
+                               int          n,
+                               Rect         q,
+                               int*         out) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (right[i] >= q.left && left[i] <= q.right && bottom[i] >= q.top && top[i] <= q.bottom) {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+#ifdef RECT_FILTER_X86
+
+// Añadir a `out` las posiciones `base + i` de los bits activos de `mask`
+static inline int push_mask(unsigned mask, int base, int* out, int count) {
+    while (mask != 0) {
+        out[count++] = base + __builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+    return count;
+}
+
+// 4 rectángulos por iteración. Un rectángulo queda fuera si
+// right < q.left, left > q.right, bottom < q.top o top > q.bottom.
+__attribute__((target("sse2"))) static int filter_rects_sse2(const int* left,
+                                                            const int* top,
+                                                            const int* right,
+                                                            const int* bottom,
+                                                            int        n,
+                                                            Rect       q,
+                                                            int*       out) {
+    const __m128i ql = _mm_set1_epi32(q.left);
+    const __m128i qt = _mm_set1_epi32(q.top);
+    const __m128i qr = _mm_set1_epi32(q.right);
+    const __m128i qb = _mm_set1_epi32(q.bottom);
+    int           count = 0;
+    int           i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + i));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + i));
+        __m128i       miss = _mm_or_si128(_mm_cmpgt_epi32(ql, r), _mm_cmpgt_epi32(l, qr));
+        miss = _mm_or_si128(miss, _mm_or_si128(_mm_cmpgt_epi32(qt, b), _mm_cmpgt_epi32(t, qb)));
+        const unsigned hit = ~unsigned(_mm_movemask_ps(_mm_castsi128_ps(miss))) & 0xFu;
+        count = push_mask(hit, i, out, count);
+    }
+    for (; i < n; i++) {
+        if (right[i] >= q.left && left[i] <= q.right && bottom[i] >= q.top && top[i] <= q.bottom) {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+// 8 rectángulos por iteración
+__attribute__((target("avx2"))) static int filter_rects_avx2(const int* left,
+                                                            const int* top,
+                                                            const int* right,
+                                                            const int* bottom,
+                                                            int        n,
+                                                            Rect       q,
+                                                            int*       out) {
+    const __m256i ql = _mm256_set1_epi32(q.left);
+    const __m256i qt = _mm256_set1_epi32(q.top);
+    const __m256i qr = _mm256_set1_epi32(q.right);
+    const __m256i qb = _mm256_set1_epi32(q.bottom);
+    int           count = 0;
+    int           i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+        const __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top + i));
+        const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom + i));
+        __m256i miss = _mm256_or_si256(_mm256_cmpgt_epi32(ql, r), _mm256_cmpgt_epi32(l, qr));
+        miss = _mm256_or_si256(miss,
+                               _mm256_or_si256(_mm256_cmpgt_epi32(qt, b), _mm256_cmpgt_epi32(t, qb)));
+        const unsigned hit = ~unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(miss))) & 0xFFu;
+        count = push_mask(hit, i, out, count);
+    }
+    for (; i < n; i++) {
+        if (right[i] >= q.left && left[i] <= q.right && bottom[i] >= q.top && top[i] <= q.bottom) {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+// Versiones con coordenadas de 16 bits: 8 rectángulos por iteración con
+// SSE2 y 16 con AVX2. Las máscaras de 16 bits por rectángulo se empaquetan
+// a un byte por rectángulo antes de sacar los bits.
+__attribute__((target("sse2"))) static int filter_rects16_sse2(const std::int16_t* left,
+                                                              const std::int16_t* top,
+                                                              const std::int16_t* right,
+                                                              const std::int16_t* bottom,
+                                                              int                 n,
+                                                              Rect                q,
+                                                              int*                out) {
+    const __m128i ql = _mm_set1_epi16(static_cast<short>(q.left));
+    const __m128i qt = _mm_set1_epi16(static_cast<short>(q.top));
+    const __m128i qr = _mm_set1_epi16(static_cast<short>(q.right));
+    const __m128i qb = _mm_set1_epi16(static_cast<short>(q.bottom));
+    int           count = 0;
+    int           i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + i));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + i));
+        __m128i       miss = _mm_or_si128(_mm_cmpgt_epi16(ql, r), _mm_cmpgt_epi16(l, qr));
+        miss = _mm_or_si128(miss, _mm_or_si128(_mm_cmpgt_epi16(qt, b), _mm_cmpgt_epi16(t, qb)));
+        const __m128i  packed = _mm_packs_epi16(miss, _mm_setzero_si128());
+        const unsigned hit = ~unsigned(_mm_movemask_epi8(packed)) & 0xFFu;
+        count = push_mask(hit, i, out, count);
+    }
+    for (; i < n; i++) {
+        if (right[i] >= q.left && left[i] <= q.right && bottom[i] >= q.top && top[i] <= q.bottom) {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+__attribute__((target("avx2"))) static int filter_rects16_avx2(const std::int16_t* left,
+                                                              const std::int16_t* top,
+                                                              const std::int16_t* right,
+                                                              const std::int16_t* bottom,
+                                                              int                 n,
+                                                              Rect                q,
+                                                              int*                out) {
+    const __m256i ql = _mm256_set1_epi16(static_cast<short>(q.left));
+    const __m256i qt = _mm256_set1_epi16(static_cast<short>(q.top));
+    const __m256i qr = _mm256_set1_epi16(static_cast<short>(q.right));
+    const __m256i qb = _mm256_set1_epi16(static_cast<short>(q.bottom));
+    int           count = 0;
+    int           i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+        const __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top + i));
+        const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom + i));
+        __m256i miss = _mm256_or_si256(_mm256_cmpgt_epi16(ql, r), _mm256_cmpgt_epi16(l, qr));
+        miss = _mm256_or_si256(miss,
+                               _mm256_or_si256(_mm256_cmpgt_epi16(qt, b), _mm256_cmpgt_epi16(t, qb)));
+        // packs trabaja por mitades de 128 bits: los bytes útiles quedan en
+        // las posiciones 0-7 y 16-23
+        const unsigned bits =
+            unsigned(_mm256_movemask_epi8(_mm256_packs_epi16(miss, _mm256_setzero_si256())));
+        const unsigned hit = ~((bits & 0xFFu) | ((bits >> 8) & 0xFF00u)) & 0xFFFFu;
+        count = push_mask(hit, i, out, count);
+    }
+    for (; i < n; i++) {
+        if (right[i] >= q.left && left[i] <= q.right && bottom[i] >= q.top && top[i] <= q.bottom) {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+#endif
+
+typedef int (*FilterFn)(const int*, const int*, const int*, const int*, int, Rect, int*);
+typedef int (*Filter16Fn)(const std::int16_t*,
+                          const std::int16_t*,
+                          const std::int16_t*,
+                          const std::int16_t*,
+                          int,
+                          Rect,
+                          int*);
+
+struct FilterImpl {
+    FilterFn    fn;
+    Filter16Fn  fn16;
+    const char* name;
+};
+
+// Elegir la mejor versión disponible en este procesador (una sola vez)
+static FilterImpl choose_filter() {
+#ifdef RECT_FILTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {filter_rects_avx2, filter_rects16_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {filter_rects_sse2, filter_rects16_sse2, "sse2"};
+    }
+#endif
+    return {filter_rects_scalar<int>, filter_rects_scalar<std::int16_t>, "scalar"};
+}
+
+static const FilterImpl& filter_impl() {
+    static const FilterImpl impl = choose_filter();
+    return impl;
+}
+
+int filter_rects(const int* left,
+                 const int* top,
+                 const int* right,
+                 const int* bottom,
+                 int        n,
+                 Rect       q,
+                 int*       out) {
+    return filter_impl().fn(left, top, right, bottom, n, q, out);
+}
+
+// Recortar una coordenada al rango de 16 bits
+static int clamp16(int v) {
+    return v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+}
+
+int filter_rects(const std::int16_t* left,
+                 const std::int16_t* top,
+                 const std::int16_t* right,
+                 const std::int16_t* bottom,
+                 int                 n,
+                 Rect                q,
+                 int*                out) {
+    // Una consulta que queda fuera del rango no puede tocar ningún
+    // rectángulo; si no, recortarla no cambia ninguna comparación
+    if (q.right < -32768 || q.left > 32767 || q.bottom < -32768 || q.top > 32767) {
+        return 0;
+    }
+    q = {clamp16(q.left), clamp16(q.top), clamp16(q.right), clamp16(q.bottom)};
+    return filter_impl().fn16(left, top, right, bottom, n, q, out);
+}
+
+const char* rect_filter_impl() {
+    return filter_impl().name;
+}
+
+}  // namespace pro2
@@ -0,0 +1,59 @@
+#ifndef RECT_FILTER_HH
+#define RECT_FILTER_HH
+
+#include <cstdint>
+#include "geometry.hh"
+
+namespace pro2 {
+
+/**
+ * @brief Número máximo de rectángulos que acepta `filter_rects` en una llamada.
+ */
+const int RECT_FILTER_CHUNK = 64;
+
+/**
+ * @brief Filtra un grupo de rectángulos guardados por columnas (SoA) y se queda
+ * con los que intersectan `q` (límites incluidos).
+ *
+ * Usa instrucciones AVX2 o SSE2 si el procesador las tiene (se decide en tiempo
+ * de ejecución) y una versión escalar en el resto de casos. Las tres versiones
+ * dan exactamente el mismo resultado.
+ *
+ * @param left, top, right, bottom Coordenadas de los `n` rectángulos.
+ * @param n   Número de rectángulos (como mucho `RECT_FILTER_CHUNK`).
+ * @param q   Rectángulo de consulta.
+ * @param out Recibe, en orden creciente, las posiciones de los rectángulos que
+ *            intersectan `q`. Debe tener espacio para `n` enteros.
+ * @return    Número de posiciones escritas en `out`.
+ */
+int filter_rects(const int* left,
+                 const int* top,
+                 const int* right,
+                 const int* bottom,
+                 int        n,
+                 Rect       q,
+                 int*       out);
+
+/**
+ * @brief Igual que la versión anterior, para rectángulos guardados con
+ * coordenadas de 16 bits: se comparan el doble de rectángulos por instrucción.
+ *
+ * `q` puede tener cualquier valor (se recorta al rango de 16 bits, lo que no
+ * cambia el resultado).
+ */
+int filter_rects(const std::int16_t* left,
+                 const std::int16_t* top,
+                 const std::int16_t* right,
+                 const std::int16_t* bottom,
+                 int                 n,
+                 Rect                q,
+                 int*                out);
+
+/**
+ * @brief Nombre de la implementación que usa `filter_rects` ("avx2", "sse2" o "scalar").
+ */
+const char* rect_filter_impl();
+
+}  // namespace pro2
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef SMALL_VECTOR_HH
+#define SMALL_VECTOR_HH
+
+#include <algorithm>
+#include <memory_resource>
+#include <vector>
+
+// Vector que guarda hasta N elementos dentro del propio objeto y solo
+// reserva memoria (del memory_resource de su allocator) cuando se supera esa
+// capacidad. Los elementos siempre están contiguos en data(), así que se
+// pueden pasar tal cual a filter_rects. Una vez ha pasado a memoria externa
+// se queda en ella, para no volver a copiar si la celda crece otra vez.
+//
+// Solo admite lo que necesitan las celdas de Finder, y tipos triviales.
+// Con N = 0 es simplemente un std::pmr::vector.
+template <class V, int N>
+class SmallVector {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<V>;
+
+private:
+    V                   inline_[N > 0 ? N : 1];
+    std::pmr::vector<V> heap_;
+    int                 size_ = 0;
+    bool                on_heap_ = N == 0;
+
+public:
+    explicit SmallVector(const allocator_type& a = allocator_type()) : heap_(a) {}
+
+    SmallVector(const SmallVector& o, const allocator_type& a)
+        : heap_(o.heap_, a), size_(o.size_), on_heap_(o.on_heap_) {
+        if (!on_heap_) {
+            std::copy(o.inline_, o.inline_ + size_, inline_);
+        }
+    }
+
+    SmallVector(SmallVector&& o, const allocator_type& a)
+        : heap_(std::move(o.heap_), a), size_(o.size_), on_heap_(o.on_heap_) {
+        if (!on_heap_) {
+            std::copy(o.inline_, o.inline_ + size_, inline_);
+        }
+    }
+
+    int size() const {
+        return size_;
+    }
+
+    const V* data() const {
+        return on_heap_ ? heap_.data() : inline_;
+    }
+
+    V* data() {
+        return on_heap_ ? heap_.data() : inline_;
+    }
+
+    const V* begin() const {
+        return data();
+    }
+
+    const V* end() const {
+        return data() + size_;
+    }
+
+    const V& operator[](int i) const {
+        return data()[i];
+    }
+
+    V& operator[](int i) {
+        return data()[i];
+    }
+
+    V& back() {
+        return data()[size_ - 1];
+    }
+
+    void push_back(V v) {
+        // Con N == 0 siempre está en el heap: la parte interna ni se compila
+        if constexpr (N > 0) {
+            if (!on_heap_) {
+                if (size_ < N) {
+                    inline_[size_++] = v;
+                    return;
+                }
+                heap_.reserve(2 * N);
+                heap_.assign(inline_, inline_ + size_);
+                on_heap_ = true;
+            }
+        }
+        heap_.push_back(v);
+        size_++;
+    }
+
+    void pop_back() {
+        if (on_heap_) {
+            heap_.pop_back();
+        }
+        size_--;
+    }
+};
+
+#endif
@@ -83,7 +83,7 @@ bool SpecialBlock::check_hit_from_below(Pt mario_pos, Pt mario_last_pos) {
     // Mario debe estar debajo del bloque y moviéndose hacia arriba
     bool below_last_frame = mario_last_pos.y >= bottom_;
     bool crossing_now = mario_pos.y < bottom_;
-    bool horizontally_aligned = mario_pos.x >= left_ - 10 && mario_pos.x <= right_ + 10;
+    bool horizontally_aligned = mario_pos.x >= left_ - hit_margin && mario_pos.x <= right_ + hit_margin;
     
     if (below_last_frame && crossing_now && horizontally_aligned) {
         animation_offset_ = -5;  // Rebote hacia arriba
@@ -44,6 +44,12 @@ public:
     
     bool is_activated() const { return activated_; }
     
+    // Indica si está haciendo la animación de rebote (update() la avanza)
+    bool is_bouncing() const { return animation_offset_ < 0; }
+    
+    // Margen horizontal con el que check_hit_from_below acepta a Mario
+    static constexpr int hit_margin = 10;
+    
     pro2::Rect get_rect() const {
         return {left_, top_, right_, bottom_};
     }
@@ -0,0 +1,503 @@
+#ifndef STATIC_FINDER_HH
+#define STATIC_FINDER_HH
+
+#include <vector>
+#include <set>
+#include <memory_resource>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "geometry.hh"
+#include "sweep.hh"
+
+// Índice espacial inmutable para objetos que no se mueven (plataformas,
+// bloques...). Se construye de una vez a partir del vector que contiene los
+// objetos y responde consultas por rectángulo recorriendo memoria contigua.
+//
+// El grid es denso y cubre solo la caja que envuelve a todos los objetos.
+// Las celdas se guardan aplanadas (formato CSR): `cell_start_[c]` indica
+// dónde empiezan los elementos de la celda `c` dentro de `items_`, y cada
+// elemento lleva una copia del rectángulo del objeto para no tener que
+// seguir ningún puntero durante la consulta.
+//
+// El vector de objetos no debe redimensionarse después de build(), ya que
+// los resultados son punteros a sus elementos.
+//
+// Las celdas se guardan en memoria del std::pmr::memory_resource que se pasa
+// al constructor (ver Finder), que tiene que vivir más que el índice.
+//
+// Un índice construido se puede guardar como un bloque binario
+// (serialize) y volver a usar más tarde sin reconstruirlo (load): las
+// consultas leen las celdas directamente del bloque (p.ej. un fichero
+// proyectado en memoria con MappedFile). Cargar cuesta lo mismo sea cual
+// sea el número de objetos: solo se comprueban la cabecera, el número de
+// objetos, el tamaño y una huella que da el llamador; el resto del bloque
+// se da por bueno salvo que se pida comprobarlo (ver load).
+template <class T>
+class StaticFinder {
+public:
+    using key_type = const T*;
+
+    // Tamaño de celda por defecto (en píxels)
+    static constexpr int DEFAULT_CELL_SIZE = 1000;
+
+private:
+    struct Item {
+        pro2::Rect rect;
+        int        index;  // Posición del objeto en el vector original
+    };
+
+    int requested_cell_size_;  // Tamaño de celda pedido al construir
+    int cell_size_;            // Tamaño de celda usado por el último build()
+
+    // Caja del grid en coordenadas de celda
+    int min_cx_ = 0, min_cy_ = 0;
+    int cols_ = 0, rows_ = 0;
+
+    const T*          base_ = nullptr;  // Primer objeto del vector original
+    int               size_ = 0;        // Número de objetos indexados
+    std::pmr::vector<int>  cell_start_;  // cols_ * rows_ + 1 posiciones
+    std::pmr::vector<Item> items_;       // Elementos agrupados por celda
+
+    // Celdas que usan las consultas: apuntan a los vectores anteriores
+    // después de build() o al bloque binario después de load()
+    const int*  cell_start_data_ = nullptr;
+    const Item* items_data_ = nullptr;
+    int         item_count_ = 0;
+
+    // Huella de los rectángulos indexados (ver fingerprint)
+    unsigned long long level_hash_ = 0;
+
+    // Cabecera del bloque binario, seguida de cell_start (cols * rows + 1
+    // enteros) y de los item_count elementos
+    struct BlobHeader {
+        char               magic[8];
+        unsigned long long level_hash;   // fingerprint() de los objetos
+        unsigned long long body_hash;    // Hash de las celdas y los elementos
+        unsigned long long header_hash;  // Hash de los campos siguientes
+        std::int32_t       item_size;    // sizeof(Item), para detectar otra ABI
+        std::int32_t       cell_size, min_cx, min_cy, cols, rows, size, item_count;
+    };
+
+    static constexpr char BLOB_MAGIC[8] = {'S', 'F', 'I', 'N', 'D', 'E', 'R', '1'};
+
+    unsigned long long version_ = 0;  // Se incrementa con cada build()
+
+    // Hash FNV-1a de 64 bits de un bloque de memoria, continuando desde `h`
+    static unsigned long long fnv1a(const void* data, size_t n, unsigned long long h) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < n; ++i) {
+            h = (h ^ p[i]) * 1099511628211ULL;
+        }
+        return h;
+    }
+
+    static unsigned long long header_hash(const BlobHeader& h) {
+        unsigned long long x = fnv1a(&h.level_hash, sizeof(h.level_hash), 14695981039346656037ULL);
+        x = fnv1a(&h.body_hash, sizeof(h.body_hash), x);
+        return fnv1a(&h.item_size, sizeof(BlobHeader) - offsetof(BlobHeader, item_size), x);
+    }
+
+    // Coordenada de celda de una coordenada del plano (redondeando hacia -infinito)
+    int cell_coord(int v) const {
+        int c = v / cell_size_;
+        if (v % cell_size_ != 0 && v < 0) {
+            c--;
+        }
+        return c;
+    }
+
+    // Verificar si dos rectángulos intersectan
+    // Los límites están incluidos en el rectángulo
+    static bool intersects(pro2::Rect a, pro2::Rect b) {
+        return !(a.right < b.left || a.left > b.right ||
+                 a.bottom < b.top || a.top > b.bottom);
+    }
+
+    // Rango de celdas de un rectángulo, recortado a la caja del grid
+    void clipped_range(pro2::Rect r, int& x0, int& y0, int& x1, int& y1) const {
+        x0 = std::max(cell_coord(r.left) - min_cx_, 0);
+        y0 = std::max(cell_coord(r.top) - min_cy_, 0);
+        x1 = std::min(cell_coord(r.right) - min_cx_, cols_ - 1);
+        y1 = std::min(cell_coord(r.bottom) - min_cy_, rows_ - 1);
+    }
+
+    // Llamar a fn(obj) una sola vez por cada objeto que intersecta qrect.
+    // Si fn devuelve true el recorrido se detiene y se devuelve true.
+    //
+    // Un objeto que ocupa varias celdas solo se reporta desde la primera
+    // celda (arriba a la izquierda) que comparte con la consulta, así que no
+    // hace falta ninguna estructura para eliminar duplicados y la consulta
+    // no modifica nada.
+    template <class Fn>
+    bool visit(pro2::Rect qrect, Fn fn) const {
+        if (size_ == 0) {
+            return false;
+        }
+        int qx0, qy0, qx1, qy1;
+        clipped_range(qrect, qx0, qy0, qx1, qy1);
+
+        for (int cy = qy0; cy <= qy1; ++cy) {
+            for (int cx = qx0; cx <= qx1; ++cx) {
+                const int c = cy * cols_ + cx;
+                for (int i = cell_start_data_[c]; i < cell_start_data_[c + 1]; ++i) {
+                    const Item& item = items_data_[i];
+                    if (!intersects(item.rect, qrect)) {
+                        continue;
+                    }
+                    const int first_cx = std::max(cell_coord(item.rect.left) - min_cx_, qx0);
+                    const int first_cy = std::max(cell_coord(item.rect.top) - min_cy_, qy0);
+                    if (first_cx == cx && first_cy == cy && fn(base_ + item.index)) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+public:
+    // Constructor: índice vacío con celdas de `cell_size` píxels de lado, que
+    // pide su memoria a `resource` (por defecto, el heap)
+    explicit StaticFinder(int                         cell_size = DEFAULT_CELL_SIZE,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : requested_cell_size_(std::max(1, cell_size)),
+          cell_size_(requested_cell_size_),
+          cell_start_(resource),
+          items_(resource) {}
+
+    // Recurso del que el índice pide su memoria
+    std::pmr::memory_resource* resource() const {
+        return items_.get_allocator().resource();
+    }
+
+    int cell_size() const {
+        return cell_size_;
+    }
+
+    int size() const {
+        return size_;
+    }
+
+    // Versión del contenido: cambia con cada build() (ver QueryCache)
+    unsigned long long version() const {
+        return version_;
+    }
+
+    // Huella de los objetos indexados (fingerprint() de los objetos de
+    // build()). Se guarda junto al nivel para pasarla a load().
+    unsigned long long level_hash() const {
+        return level_hash_;
+    }
+
+    // Construir el índice con todos los objetos de `objects`, sustituyendo
+    // el contenido anterior.
+    void build(const std::vector<T>& objects) {
+        version_++;
+        cell_size_ = requested_cell_size_;
+        base_ = objects.data();
+        size_ = static_cast<int>(objects.size());
+        cell_start_.clear();
+        items_.clear();
+        cell_start_data_ = nullptr;
+        items_data_ = nullptr;
+        item_count_ = 0;
+        level_hash_ = fingerprint(objects);
+        cols_ = rows_ = 0;
+        if (objects.empty()) {
+            return;
+        }
+
+        std::vector<pro2::Rect> rects;
+        rects.reserve(objects.size());
+        pro2::Rect bbox = objects[0].get_rect();
+        for (const T& obj : objects) {
+            pro2::Rect r = obj.get_rect();
+            bbox.left = std::min(bbox.left, r.left);
+            bbox.top = std::min(bbox.top, r.top);
+            bbox.right = std::max(bbox.right, r.right);
+            bbox.bottom = std::max(bbox.bottom, r.bottom);
+            rects.push_back(r);
+        }
+
+        // Si los objetos están muy dispersos, agrandar las celdas para que
+        // el grid denso no tenga muchas más celdas que objetos
+        const long long max_cells = 4LL * size_ + 64;
+        for (;;) {
+            min_cx_ = cell_coord(bbox.left);
+            min_cy_ = cell_coord(bbox.top);
+            long long cols = static_cast<long long>(cell_coord(bbox.right)) - min_cx_ + 1;
+            long long rows = static_cast<long long>(cell_coord(bbox.bottom)) - min_cy_ + 1;
+            if (cols * rows <= max_cells) {
+                cols_ = static_cast<int>(cols);
+                rows_ = static_cast<int>(rows);
+                break;
+            }
+            cell_size_ *= 2;
+        }
+
+        // Contar los elementos de cada celda, acumular y repartir
+        cell_start_.assign(static_cast<size_t>(cols_) * rows_ + 1, 0);
+        for (const pro2::Rect& r : rects) {
+            for (int cy = cell_coord(r.top) - min_cy_; cy <= cell_coord(r.bottom) - min_cy_; ++cy) {
+                for (int cx = cell_coord(r.left) - min_cx_; cx <= cell_coord(r.right) - min_cx_; ++cx) {
+                    cell_start_[cy * cols_ + cx + 1]++;
+                }
+            }
+        }
+        for (size_t c = 1; c < cell_start_.size(); ++c) {
+            cell_start_[c] += cell_start_[c - 1];
+        }
+        items_.resize(cell_start_.back());
+        std::vector<int> fill(cell_start_.begin(), cell_start_.end() - 1);
+        for (int i = 0; i < size_; ++i) {
+            const pro2::Rect& r = rects[i];
+            for (int cy = cell_coord(r.top) - min_cy_; cy <= cell_coord(r.bottom) - min_cy_; ++cy) {
+                for (int cx = cell_coord(r.left) - min_cx_; cx <= cell_coord(r.right) - min_cx_; ++cx) {
+                    items_[fill[cy * cols_ + cx]++] = {r, i};
+                }
+            }
+        }
+        cell_start_data_ = cell_start_.data();
+        items_data_ = items_.data();
+        item_count_ = static_cast<int>(items_.size());
+    }
+
+    // Huella de los rectángulos de `objects`: un bloque guardado con
+    // serialize() solo se acepta para objetos con la misma huella. Recorre
+    // todos los objetos: se calcula al guardar el nivel, no al cargarlo.
+    static unsigned long long fingerprint(const std::vector<T>& objects) {
+        unsigned long long h = 14695981039346656037ULL;
+        const std::int32_t n = static_cast<std::int32_t>(objects.size());
+        h = fnv1a(&n, sizeof(n), h);
+        for (const T& obj : objects) {
+            const pro2::Rect     r = obj.get_rect();
+            const std::int32_t v[4] = {r.left, r.top, r.right, r.bottom};
+            h = fnv1a(v, sizeof(v), h);
+        }
+        return h;
+    }
+
+    // Guardar el índice en un bloque binario (se sustituye el contenido de
+    // `out`). El formato depende de la arquitectura: se guarda y se carga en
+    // la misma máquina.
+    void serialize(std::vector<char>& out) const {
+        BlobHeader h;
+        std::memcpy(h.magic, BLOB_MAGIC, sizeof(h.magic));
+        h.level_hash = level_hash_;
+        h.item_size = sizeof(Item);
+        h.cell_size = cell_size_;
+        h.min_cx = min_cx_;
+        h.min_cy = min_cy_;
+        h.cols = cols_;
+        h.rows = rows_;
+        h.size = size_;
+        h.item_count = item_count_;
+
+        const size_t cells = size_ > 0 ? static_cast<size_t>(cols_) * rows_ + 1 : 0;
+        out.resize(sizeof(h) + cells * sizeof(int) + item_count_ * sizeof(Item));
+        char* p = out.data();
+        if (cells > 0) {
+            std::memcpy(p + sizeof(h), cell_start_data_, cells * sizeof(int));
+            std::memcpy(p + sizeof(h) + cells * sizeof(int), items_data_,
+                        item_count_ * sizeof(Item));
+        }
+        h.body_hash = fnv1a(p + sizeof(h), out.size() - sizeof(h), 14695981039346656037ULL);
+        h.header_hash = header_hash(h);
+        std::memcpy(p, &h, sizeof(h));
+    }
+
+    // Usar un índice guardado con serialize() para los objetos de
+    // `objects`, sin reconstruirlo. Las consultas leen directamente de
+    // `data`, que tiene que seguir accesible (y sin cambios) mientras se use
+    // el índice o hasta el siguiente build()/load().
+    //
+    // Sin `verify_body` solo se comprueba, sin recorrer nada:
+    //  - la cabecera (marca, su propia suma de control, tamaño de Item,
+    //    dimensiones no negativas) y que el índice sea de objects.size()
+    //    objetos;
+    //  - que `size` sea exactamente el que corresponde a esa cabecera;
+    //  - que la huella guardada en el bloque sea `level_hash`.
+    // El contenido de las celdas (inicios de celda e índices de objeto) se
+    // da por bueno: un bloque dañado del tamaño correcto hace que las
+    // consultas lean fuera de `data` o de `objects`. Con `verify_body`
+    // también se comprueba la suma de control de todo el bloque, que cuesta
+    // tanto como leerlo; hay que pedirlo para ficheros que pueden haberse
+    // dañado.
+    //
+    // La huella no se calcula a partir de `objects`: `level_hash` tiene que
+    // venir de la misma fuente que los datos del nivel con que se llenó
+    // `objects` (p.ej. level_hash() del índice que se serializó, guardado
+    // junto a esos datos). Si no, un bloque de otro nivel con el mismo
+    // número de objetos se acepta.
+    //
+    // Devuelve false, sin cambiar el índice, si alguna comprobación falla;
+    // en ese caso hay que llamar a build().
+    bool load(const void*               data,
+              size_t                    size,
+              const std::vector<T>&     objects,
+              unsigned long long        level_hash,
+              bool                      verify_body = false) {
+        BlobHeader h;
+        if (data == nullptr || size < sizeof(h) ||
+            reinterpret_cast<std::uintptr_t>(data) % alignof(Item) != 0) {
+            return false;
+        }
+        std::memcpy(&h, data, sizeof(h));
+        if (std::memcmp(h.magic, BLOB_MAGIC, sizeof(h.magic)) != 0 ||
+            h.header_hash != header_hash(h) || h.item_size != sizeof(Item) || h.cell_size <= 0 ||
+            h.cols < 0 || h.rows < 0 || h.item_count < 0 ||
+            h.size != static_cast<std::int32_t>(objects.size())) {
+            return false;
+        }
+        const size_t cells = h.size > 0 ? static_cast<size_t>(h.cols) * h.rows + 1 : 0;
+        if (size != sizeof(h) + cells * sizeof(int) + h.item_count * sizeof(Item)) {
+            return false;
+        }
+        const char* p = static_cast<const char*>(data) + sizeof(h);
+        if (h.level_hash != level_hash ||
+            (verify_body && h.body_hash != fnv1a(p, size - sizeof(h), 14695981039346656037ULL))) {
+            return false;
+        }
+
+        version_++;
+        cell_start_.clear();
+        items_.clear();
+        base_ = objects.data();
+        size_ = h.size;
+        level_hash_ = h.level_hash;
+        cell_size_ = h.cell_size;
+        min_cx_ = h.min_cx;
+        min_cy_ = h.min_cy;
+        cols_ = h.cols;
+        rows_ = h.rows;
+        item_count_ = h.item_count;
+        cell_start_data_ = cells > 0 ? reinterpret_cast<const int*>(p) : nullptr;
+        items_data_ = cells > 0 ? reinterpret_cast<const Item*>(p + cells * sizeof(int)) : nullptr;
+        return true;
+    }
+
+    // Llamar a fn(const T*) para cada objeto que intersecta qrect, sin
+    // construir ningún contenedor. El orden no está especificado.
+    template <class Fn>
+    void for_each_in(pro2::Rect qrect, Fn fn) const {
+        visit(qrect, [&](const T* obj) {
+            fn(obj);
+            return false;
+        });
+    }
+
+    // Indica si algún objeto que intersecta qrect cumple pred(const T*).
+    // Se detiene en el primer objeto que lo cumple.
+    template <class Pred>
+    bool any_in(pro2::Rect qrect, Pred pred) const {
+        return visit(qrect, [&](const T* obj) { return bool(pred(obj)); });
+    }
+
+    // Consultar objetos que intersectan con un rectángulo, escribiendo el
+    // resultado en un vector del llamador (se vacía primero)
+    void query(pro2::Rect qrect, std::vector<const T*>& result) const {
+        result.clear();
+        for_each_in(qrect, [&](const T* obj) { result.push_back(obj); });
+    }
+
+    // Consultar varios rectángulos a la vez (p.ej. la cámara y sus márgenes)
+    // recorriendo una sola vez las celdas que cubren todos ellos.
+    // results[i] recibe los objetos que intersectan rects[i].
+    void query_many(const std::vector<pro2::Rect>&        rects,
+                    std::vector<std::vector<const T*>>& results) const {
+        results.resize(rects.size());
+        for (std::vector<const T*>& r : results) {
+            r.clear();
+        }
+        if (rects.empty() || size_ == 0) {
+            return;
+        }
+        pro2::Rect all = rects[0];
+        for (const pro2::Rect& r : rects) {
+            all.left = std::min(all.left, r.left);
+            all.top = std::min(all.top, r.top);
+            all.right = std::max(all.right, r.right);
+            all.bottom = std::max(all.bottom, r.bottom);
+        }
+        int ax0, ay0, ax1, ay1;
+        clipped_range(all, ax0, ay0, ax1, ay1);
+        for (int cy = ay0; cy <= ay1; ++cy) {
+            for (int cx = ax0; cx <= ax1; ++cx) {
+                const int c = cy * cols_ + cx;
+                for (int i = cell_start_data_[c]; i < cell_start_data_[c + 1]; ++i) {
+                    const Item& item = items_data_[i];
+                    const int   obj_cx = cell_coord(item.rect.left) - min_cx_;
+                    const int   obj_cy = cell_coord(item.rect.top) - min_cy_;
+                    for (size_t k = 0; k < rects.size(); ++k) {
+                        if (!intersects(item.rect, rects[k])) {
+                            continue;
+                        }
+                        // Igual que en visit(): solo desde la primera celda
+                        // que el objeto comparte con rects[k]
+                        int x0, y0, x1, y1;
+                        clipped_range(rects[k], x0, y0, x1, y1);
+                        if (std::max(obj_cx, x0) == cx && std::max(obj_cy, y0) == cy) {
+                            results[k].push_back(base_ + item.index);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Objetos que toca el rectángulo `moving` al desplazarse `delta`,
+    // ordenados por instante de contacto (0 = posición inicial, 1 = final).
+    // Solo se visitan las celdas por las que pasa el rectángulo.
+    void sweep(pro2::Rect                               moving,
+               pro2::Pt                                 delta,
+               std::vector<pro2::SweepHit<const T*>>& hits) const {
+        hits.clear();
+        if (size_ == 0) {
+            return;
+        }
+        auto coord = [this](int v) { return cell_coord(v); };
+        pro2::for_each_cell_swept(moving, delta, cell_size_, coord, [&](int cx, int cy, pro2::Rect area) {
+            cx -= min_cx_;
+            cy -= min_cy_;
+            if (cx < 0 || cx >= cols_ || cy < 0 || cy >= rows_) {
+                return false;
+            }
+            const int c = cy * cols_ + cx;
+            for (int i = cell_start_data_[c]; i < cell_start_data_[c + 1]; ++i) {
+                const Item& item = items_data_[i];
+                double      t;
+                if (intersects(item.rect, area) && pro2::sweep_rect(moving, delta, item.rect, t)) {
+                    hits.push_back({base_ + item.index, t});
+                }
+            }
+            return false;
+        });
+        // Un objeto puede aparecer desde varias celdas del recorrido, siempre
+        // con el mismo instante: ordenar por (t, objeto) y quitar repetidos
+        std::sort(hits.begin(), hits.end(),
+                  [](const pro2::SweepHit<const T*>& a, const pro2::SweepHit<const T*>& b) {
+                      return a.t != b.t ? a.t < b.t : a.key < b.key;
+                  });
+        hits.erase(std::unique(hits.begin(), hits.end(),
+                               [](const pro2::SweepHit<const T*>& a,
+                                  const pro2::SweepHit<const T*>& b) { return a.key == b.key; }),
+                   hits.end());
+    }
+
+    // Objetos que toca el segmento de `from` a `to`, ordenados por distancia
+    // a `from` (t = fracción del segmento recorrida)
+    void raycast(pro2::Pt from, pro2::Pt to, std::vector<pro2::SweepHit<const T*>>& hits) const {
+        sweep({from.x, from.y, from.x, from.y}, {to.x - from.x, to.y - from.y}, hits);
+    }
+
+    // Consultar objetos que intersectan con un rectángulo
+    std::set<const T*> query(pro2::Rect qrect) const {
+        std::vector<const T*> found;
+        query(qrect, found);
+        return std::set<const T*>(found.begin(), found.end());
+    }
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef SWEEP_HH
+#define SWEEP_HH
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "geometry.hh"
+
+namespace pro2 {
+
+/**
+ * @brief Resultado de una consulta de barrido: el objeto y el instante de contacto.
+ *
+ * `t` va de 0 (posición inicial) a 1 (posición final del movimiento).
+ */
+template <class Key>
+struct SweepHit {
+    Key    key;
+    double t;
+};
+
+/**
+ * @brief Intervalo de tiempo en el que el intervalo [a0, a1] desplazado s·d
+ * se solapa con [b0, b1] (límites incluidos), recortado a [0, 1].
+ *
+ * @return false si no se solapan en ningún instante de [0, 1].
+ */
+inline bool sweep_interval(int a0, int a1, int d, int b0, int b1, double& s0, double& s1) {
+    if (d == 0) {
+        s0 = 0.0;
+        s1 = 1.0;
+        return a1 >= b0 && a0 <= b1;
+    }
+    // a0 + s·d <= b1  y  a1 + s·d >= b0
+    double enter = d > 0 ? double(b0 - a1) / d : double(b1 - a0) / d;
+    double exit = d > 0 ? double(b1 - a0) / d : double(b0 - a1) / d;
+    s0 = std::max(enter, 0.0);
+    s1 = std::min(exit, 1.0);
+    return s0 <= s1;
+}
+
+/**
+ * @brief Primer instante en que el rectángulo `moving`, desplazándose `delta`,
+ * toca el rectángulo `target` (límites incluidos).
+ *
+ * @param t Recibe el instante de contacto, entre 0 y 1.
+ * @return false si no llegan a tocarse durante el movimiento.
+ */
+inline bool sweep_rect(Rect moving, Pt delta, Rect target, double& t) {
+    double x0, x1, y0, y1;
+    if (!sweep_interval(moving.left, moving.right, delta.x, target.left, target.right, x0, x1) ||
+        !sweep_interval(moving.top, moving.bottom, delta.y, target.top, target.bottom, y0, y1)) {
+        return false;
+    }
+    t = std::max(x0, y0);
+    return t <= std::min(x1, y1);
+}
+
+/**
+ * @brief Caja que cubre todo el recorrido de `r` al desplazarse `delta`.
+ */
+inline Rect swept_bounds(Rect r, Pt delta) {
+    return {std::min(r.left, r.left + delta.x), std::min(r.top, r.top + delta.y),
+            std::max(r.right, r.right + delta.x), std::max(r.bottom, r.bottom + delta.y)};
+}
+
+/**
+ * @brief Llama a `fn(cx, cy, area)` para cada celda de un grid por la que
+ * pasa el rectángulo `r` al desplazarse `delta`.
+ *
+ * Recorre columna a columna: para cada columna calcula el intervalo de tiempo
+ * en que el rectángulo la atraviesa y solo las filas que ocupa durante ese
+ * intervalo, así que un movimiento en diagonal visita una banda de celdas y no
+ * toda la caja que envuelve el recorrido. `area` es la parte del recorrido que
+ * cae en esa columna (sirve para descartar candidatos). Si `fn` devuelve true
+ * el recorrido se detiene.
+ *
+ * @param cell_size  Lado de las celdas.
+ * @param cell_coord Función que da la coordenada de celda de una coordenada.
+ */
+template <class CellCoord, class Fn>
+void for_each_cell_swept(Rect r, Pt delta, int cell_size, CellCoord cell_coord, Fn fn) {
+    const Rect bounds = swept_bounds(r, delta);
+    const int  cx0 = cell_coord(bounds.left), cx1 = cell_coord(bounds.right);
+    for (int cx = cx0; cx <= cx1; ++cx) {
+        const long long col_left = static_cast<long long>(cx) * cell_size;
+        const long long col_right = col_left + cell_size - 1;
+        double          s0 = 0.0, s1 = 1.0;
+        if (delta.x != 0) {
+            double enter = delta.x > 0 ? double(col_left - r.right) / delta.x
+                                       : double(col_right - r.left) / delta.x;
+            double exit = delta.x > 0 ? double(col_right - r.left) / delta.x
+                                      : double(col_left - r.right) / delta.x;
+            s0 = std::max(enter, 0.0);
+            s1 = std::min(exit, 1.0);
+            if (s0 > s1) {
+                continue;
+            }
+        }
+        // Filas ocupadas mientras el rectángulo atraviesa la columna
+        // (redondeando hacia fuera para no perder ninguna celda)
+        Rect area;
+        area.left = std::max<long long>(bounds.left, col_left);
+        area.right = std::min<long long>(bounds.right, col_right);
+        area.top = r.top + int(std::floor(std::min(s0 * delta.y, s1 * delta.y)));
+        area.bottom = r.bottom + int(std::ceil(std::max(s0 * delta.y, s1 * delta.y)));
+        area.top = std::max(area.top, bounds.top);
+        area.bottom = std::min(area.bottom, bounds.bottom);
+        for (int cy = cell_coord(area.top); cy <= cell_coord(area.bottom); ++cy) {
+            if (fn(cx, cy, area)) {
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Ordena los resultados de un barrido por instante de contacto
+ * (a igual instante se mantiene el orden en que se encontraron).
+ */
+template <class Key>
+void sort_hits(std::vector<SweepHit<Key>>& hits) {
+    std::stable_sort(hits.begin(), hits.end(),
+                     [](const SweepHit<Key>& a, const SweepHit<Key>& b) { return a.t < b.t; });
+}
+
+}  // namespace pro2
+
+#endif
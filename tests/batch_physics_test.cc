@@ -0,0 +1,98 @@
+// Comprueba que las versiones SSE2 y AVX2 de physics_step dan exactamente
+// el mismo resultado que physics_step_scalar: lotes de todos los tamaños
+// (incluidos los restos de n % 4 y n % 8 que se hacen uno a uno), suelos
+// de relleno PHYSICS_NO_FLOOR_*, trozos de un lote mayor (stride > n) y
+// valores cerca de los límites de int.
+
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../batch_physics.hh"
+
+using namespace pro2;
+
+namespace {
+
+struct Lot {
+    std::vector<int> x, y, vx, vy;
+
+    PhysicsBatch batch(int offset, int n) {
+        return {x.data() + offset, y.data() + offset, vx.data() + offset, vy.data() + offset, n};
+    }
+
+    bool operator==(const Lot& o) const {
+        return x == o.x && y == o.y && vx == o.vx && vy == o.vy;
+    }
+};
+
+std::mt19937 rng(12345);
+
+int rnd(int a, int b) {
+    return std::uniform_int_distribution<int>(a, b)(rng);
+}
+
+}  // namespace
+
+int main() {
+    const char* impls[] = {"sse2", "avx2"};
+    int         failures = 0;
+    int         runs[2] = {0, 0};
+
+    for (int it = 0; it < 20000; ++it) {
+        // Lote completo de `total` entidades del que se avanza el trozo
+        // [offset, offset + n); los suelos tienen stride = total
+        const int total = rnd(0, 40);
+        const int offset = total > 0 && rnd(0, 1) ? rnd(0, total) : 0;
+        const int n = total - offset - (total - offset > 0 ? rnd(0, total - offset) / 2 : 0);
+        const int rounds = rnd(0, 4);
+        const bool extreme = rnd(0, 9) == 0;
+
+        Lot lot;
+        for (int k = 0; k < total; ++k) {
+            lot.x.push_back(extreme ? rnd(INT_MAX - 100, INT_MAX - 40) : rnd(-100, 100));
+            lot.y.push_back(extreme ? rnd(INT_MIN + 40, INT_MIN + 100) : rnd(-100, 100));
+            lot.vx.push_back(rnd(0, 4) == 0 ? rnd(-30, 30) : (rnd(0, 1) ? 2 : -2));
+            lot.vy.push_back(rnd(-5, 25));
+        }
+        std::vector<int> left(rounds * total), right(rounds * total), top(rounds * total);
+        for (int j = 0; j < rounds * total; ++j) {
+            if (rnd(0, 3) == 0) {
+                left[j] = PHYSICS_NO_FLOOR_LEFT;
+                right[j] = PHYSICS_NO_FLOOR_RIGHT;
+                top[j] = rnd(-100, 100);
+            } else {
+                left[j] = rnd(-120, 100);
+                right[j] = left[j] + rnd(0, 150);
+                top[j] = rnd(-110, 130);
+            }
+        }
+        const PhysicsFloors floors = {left.data() + offset, right.data() + offset, top.data() + offset,
+                                      rounds, total};
+
+        Lot reference = lot;
+        physics_step_scalar(reference.batch(offset, n), floors);
+        for (int i = 0; i < 2; ++i) {
+            Lot result = lot;
+            if (!physics_step_with(impls[i], result.batch(offset, n), floors)) {
+                continue;
+            }
+            runs[i]++;
+            if (!(result == reference)) {
+                std::printf("FALLO %s: total=%d offset=%d n=%d rondas=%d\n", impls[i], total, offset, n,
+                            rounds);
+                failures++;
+            }
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (runs[i] == 0) {
+            std::printf("%s: no disponible en este procesador\n", impls[i]);
+        } else {
+            std::printf("%s: %d lotes comparados\n", impls[i], runs[i]);
+        }
+    }
+    std::printf("%d fallos\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// Prueba de estrés de ConcurrentFinder: varios hilos lectores consultan sin
+// parar mientras el escritor mueve, quita y vuelve a añadir objetos y
+// publica una versión nueva en cada vuelta.
+//
+// El estado de la versión v se puede calcular desde cualquier hilo
+// (expected), así que cada resultado se comprueba contra las versiones que
+// el lector pudo ver: las publicadas entre antes y después de su consulta.
+// Un resultado que no coincide con ninguna de ellas mezcla instantáneas.
+//
+// Compilar con -fsanitize=thread para detectar además carreras de datos.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../concurrent_finder.hh"
+
+namespace {
+
+const int OBJECTS = 2000;
+const int VERSIONS = 3000;
+const int READERS = 4;
+
+struct Obj {};
+
+// El objeto id está en la versión v si (id + v) % 3 != 0, desplazado v % 7 píxels
+bool present(int id, unsigned long long v) {
+    return v > 0 && (id + v) % 3 != 0;
+}
+
+pro2::Rect rect_of(int id, unsigned long long v) {
+    const int x = id * 10 + static_cast<int>(v % 7);
+    const int y = (id % 50) * 10;
+    return {x, y, x + 3, y + 3};
+}
+
+bool intersects(pro2::Rect a, pro2::Rect b) {
+    return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+// Objetos de la versión v que intersectan q, ordenados
+std::vector<int> expected(unsigned long long v, pro2::Rect q) {
+    std::vector<int> ids;
+    for (int id = 0; id < OBJECTS; ++id) {
+        if (present(id, v) && intersects(rect_of(id, v), q)) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+}  // namespace
+
+int main() {
+    using Finder = ConcurrentFinder<Obj, int>;
+    Finder finder(64);
+
+    // No puede haber más de MAX_READERS Readers a la vez
+    {
+        std::vector<std::unique_ptr<Finder::Reader>> readers;
+        for (int i = 0; i < Finder::MAX_READERS; ++i) {
+            readers.push_back(std::make_unique<Finder::Reader>(finder));
+        }
+        bool thrown = false;
+        try {
+            Finder::Reader extra(finder);
+        } catch (const std::length_error&) {
+            thrown = true;
+        }
+        if (!thrown) {
+            std::printf("FALLO: el Reader %d no ha fallado\n", Finder::MAX_READERS + 1);
+            return 1;
+        }
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<int>  failures{0};
+    std::atomic<long> checked{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; ++r) {
+        readers.emplace_back([&, r] {
+            Finder::Reader   reader(finder);
+            std::mt19937     rng(r + 1);
+            std::vector<int> found;
+            while (!done.load()) {
+                const int        x = std::uniform_int_distribution<int>(-20, OBJECTS * 10)(rng);
+                const int        y = std::uniform_int_distribution<int>(-20, 500)(rng);
+                const pro2::Rect q = {x, y, x + std::uniform_int_distribution<int>(0, 400)(rng),
+                                      y + std::uniform_int_distribution<int>(0, 200)(rng)};
+                const unsigned long long before = reader.version();
+                reader.query(q, found);
+                const unsigned long long after = reader.version();
+                std::sort(found.begin(), found.end());
+                bool ok = false;
+                for (unsigned long long v = before; v <= after && !ok; ++v) {
+                    ok = found == expected(v, q);
+                }
+                if (!ok) {
+                    std::printf("FALLO: consulta entre las versiones %llu y %llu\n", before, after);
+                    failures++;
+                }
+                checked++;
+            }
+        });
+    }
+
+    // Escritor: cada vuelta cambia todos los objetos, así que cada publish()
+    // da exactamente la versión siguiente
+    for (unsigned long long v = 1; v <= VERSIONS; ++v) {
+        for (int id = 0; id < OBJECTS; ++id) {
+            if (present(id, v)) {
+                finder.update(id, rect_of(id, v));
+            } else {
+                finder.remove(id);
+            }
+        }
+        finder.publish();
+        if (finder.version() != v) {
+            std::printf("FALLO: versión %llu publicada como %llu\n", v, finder.version());
+            failures++;
+        }
+    }
+    done = true;
+    for (std::thread& t : readers) {
+        t.join();
+    }
+    finder.publish();
+
+    std::printf("%ld consultas comprobadas, %d fallos, %d instantáneas sin liberar\n", checked.load(),
+                failures.load(), finder.retired_count());
+    return failures == 0 && finder.retired_count() == 0 ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#ifndef TIMER_SCHEDULER_HH
+#define TIMER_SCHEDULER_HH
+
+#include <queue>
+#include <vector>
+
+// Eventos programados para un frame concreto (fin de un power-up, fin de
+// una animación, reaparición de un enemigo...).
+//
+// Cada evento se guarda con el frame absoluto en que vence, en un montículo
+// ordenado por ese frame: mientras no vence no cuesta nada, y cada frame
+// solo hay que mirar el primero. Los eventos que vencen en el mismo frame
+// salen en el orden en que se programaron, así que el resultado es siempre
+// el mismo.
+//
+// Un evento programado no se puede cancelar: quien lo recibe debe comprobar
+// si todavía es vigente (p.ej. si el efecto se ha alargado después).
+template <class Event>
+class TimerScheduler {
+    struct Timer {
+        int                deadline;
+        unsigned long long seq;  // Orden de llegada, para desempatar
+        Event              event;
+    };
+
+    // El montículo de la STL deja arriba el mayor: "mayor" es el que vence antes
+    struct Later {
+        bool operator()(const Timer& a, const Timer& b) const {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+        }
+    };
+
+    std::priority_queue<Timer, std::vector<Timer>, Later> timers_;
+    unsigned long long                                    next_seq_ = 0;
+
+public:
+    bool empty() const {
+        return timers_.empty();
+    }
+
+    int size() const {
+        return static_cast<int>(timers_.size());
+    }
+
+    // Frame en que vence el próximo evento (no debe estar vacío)
+    int next_deadline() const {
+        return timers_.top().deadline;
+    }
+
+    // Programar `event` para el frame `deadline`
+    void schedule(int deadline, Event event) {
+        timers_.push({deadline, next_seq_++, event});
+    }
+
+    // Llamar a fn(event, deadline) para cada evento que vence en el frame
+    // `now` o antes, en orden de vencimiento, y quitarlos. fn puede
+    // programar eventos nuevos; si vencen en `now` o antes también se
+    // procesan en esta llamada.
+    template <class Fn>
+    void run_due(int now, Fn fn) {
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            const Timer t = timers_.top();
+            timers_.pop();
+            fn(t.event, t.deadline);
+        }
+    }
+
+    void clear() {
+        timers_ = {};
+    }
+};
+
+#endif